@@ -1,3 +1,3 @@
 from .graph import Graph
-from .color_refinement import ColorRefinement
+from .color_refinement import ColorRefinement, stable_coloring, have_engine
 
@@ -24,6 +24,24 @@ The following code is a extended python version of Amenability_test by Christoph
 # Use numpy's fixed-precision integers
 import numpy as np
 
+# C++ engine (see setup.py), used when built
+try:
+    from . import _engine
+except ImportError:
+    _engine = None
+
+def have_engine():
+    return _engine is not None
+
+# stable coloring of graph given by numpy arrays with the C++ engine: nodes are
+# { 0, ..., num_nodes - 1 }, edge labels in { 0, ..., num_edge_labels - 1 }, and
+# options are those of _engine.Graph.stable_coloring(). Returns number of
+# iterations and numpy array with color of each node
+def stable_coloring(num_nodes, edges_src, edges_dst, edge_labels=None, node_labels=None, num_edge_labels=None, directed=True, **options):
+    if _engine is None: raise RuntimeError('C++ engine not built (run setup.py build_ext --inplace in python/)')
+    graph = _engine.Graph(num_nodes, edges_src, edges_dst, edge_labels, node_labels, num_edge_labels, directed)
+    return graph.stable_coloring(**options)
+
 class ColorRefinement:
     def __init__(self, graph):
         self._graph = graph
@@ -41,6 +59,9 @@ class ColorRefinement:
         # assumption: edge labels are in { 0, ..., num_edge_labels - 1 }.
         for label in edge_labels: assert label < num_edge_labels
 
+        if _engine is not None:
+            return self._compute_stable_coloring_with_engine(node_labels, num_edge_labels, edge_labels, normalize_colors)
+
         # need node labels { 1, ... } since color 0 is marker
         add_one_to_node_labels = False
         for label in node_labels:
@@ -133,6 +154,27 @@ class ColorRefinement:
             node_to_color.append(color)
         return num_iterations, node_colors, color_to_nodes, node_to_color
 
+    # same as compute_stable_coloring() but with the C++ engine. Colors are those
+    # of the C++ implementation (unsigned 64-bit colors).
+    def _compute_stable_coloring_with_engine(self, node_labels, num_edge_labels, edge_labels, normalize_colors):
+        graph = self._graph
+        num_nodes = graph.get_num_nodes()
+        edges_src = np.asarray(graph._edges_src, dtype=np.uint32)
+        edges_dst = np.asarray(graph._edges_dst, dtype=np.uint32)
+        engine_graph = _engine.Graph(num_nodes, edges_src, edges_dst, np.asarray(edge_labels, dtype=np.uint64),
+                                     np.asarray(node_labels, dtype=np.uint64), num_edge_labels, True)
+        num_iterations, colors = engine_graph.stable_coloring(normalize_colors=normalize_colors)
+
+        # compute output
+        node_to_color = colors.tolist()
+        color_to_nodes = dict()
+        for v, color in enumerate(node_to_color):
+            if color not in color_to_nodes:
+                color_to_nodes[color] = set()
+            color_to_nodes[color].add(v)
+        node_colors = set(color_to_nodes.keys())
+        return num_iterations, node_colors, color_to_nodes, node_to_color
+
     # pairing function: bijection of NxN onto N
     def pairing(self, a, b):
         r = a * a + a + b if a >= b else a + b * b
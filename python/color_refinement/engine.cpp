@@ -0,0 +1,291 @@
+/**********************************************************************
+ * Python bindings of the C++ refinement engine (module
+ * color_refinement._engine).
+ *
+ * Graph(num_nodes, edges_src, edges_dst, edge_labels=None, node_labels=None,
+ *       num_edge_labels=None, directed=True)
+ *     builds the CSR view of a graph from numpy arrays (or any sequence).
+ *     Arrays of dtype uint32 (nodes) and uint64 (labels) that are
+ *     C-contiguous are read in place; arrays of other integer dtypes (such
+ *     as numpy's default int64) are converted first, after checking that
+ *     their values are non-negative and fit the dtype.
+ *
+ * Graph.stable_coloring(node_labels=None, normalize_colors=False,
+ *                       exact_colors=False, sparse_labels=False,
+ *                       num_threads=1, max_rounds=0, time_budget=0)
+ *     returns (#iterations, colors) where colors is a numpy uint64 array
+ *     with the color of each node, as computed by wl. With max_rounds or
+ *     time_budget (seconds), the coloring may not be stable.
+ *
+ * The graph is built and refined with the GIL released.
+ *********************************************************************/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include "CSRGraph.h"
+#include "ColorRefinement.h"
+
+using namespace std;
+
+namespace {
+    struct GraphObject {
+        PyObject_HEAD
+        GraphLibrary::CSRGraph *csr;
+    };
+
+    // Contiguous array of given unsigned type for "object" (a new reference,
+    // which is "object" itself if it already is such an array), or null with
+    // an exception set. Integers of other types are cast if they are in the
+    // range of "type", and other values are rejected.
+    PyArrayObject* as_array(PyObject *object, int type, const char *name) {
+        PyArrayObject *array = reinterpret_cast<PyArrayObject*>(PyArray_FromAny(object, nullptr, 1, 1, NPY_ARRAY_IN_ARRAY, nullptr));
+        if( (array == nullptr) || (PyArray_TYPE(array) == type) ) return array;
+        if( PyArray_SIZE(array) > 0 ) {
+            if( !PyArray_ISINTEGER(array) ) {
+                PyErr_Format(PyExc_TypeError, "%s must be an array of integers", name);
+                Py_DECREF(array);
+                return nullptr;
+            }
+
+            // Signed values are read as int64 and unsigned ones as uint64 (safe casts).
+            bool is_signed = PyArray_ISSIGNED(array);
+            PyArrayObject *wide = reinterpret_cast<PyArrayObject*>(PyArray_FROMANY(reinterpret_cast<PyObject*>(array), is_signed ? NPY_INT64 : NPY_UINT64, 1, 1, NPY_ARRAY_IN_ARRAY));
+            if( wide == nullptr ) {
+                Py_DECREF(array);
+                return nullptr;
+            }
+            uint64_t max_value = type == NPY_UINT32 ? uint64_t(uint32_t(-1)) : uint64_t(-1);
+            bool in_range = true;
+            for( npy_intp i = 0; in_range && (i < PyArray_SIZE(wide)); ++i ) {
+                if( is_signed ) {
+                    int64_t value = static_cast<const int64_t*>(PyArray_DATA(wide))[i];
+                    in_range = (value >= 0) && (uint64_t(value) <= max_value);
+                } else {
+                    in_range = static_cast<const uint64_t*>(PyArray_DATA(wide))[i] <= max_value;
+                }
+            }
+            Py_DECREF(wide);
+            if( !in_range ) {
+                PyErr_Format(PyExc_ValueError, "%s has values that are negative or too large", name);
+                Py_DECREF(array);
+                return nullptr;
+            }
+        }
+        PyArrayObject *result = reinterpret_cast<PyArrayObject*>(PyArray_FROMANY(reinterpret_cast<PyObject*>(array), type, 1, 1, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST));
+        Py_DECREF(array);
+        return result;
+    }
+
+    void Graph_dealloc(GraphObject *self) {
+        delete self->csr;
+        Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+    }
+
+    int Graph_init(GraphObject *self, PyObject *args, PyObject *kwargs) {
+        static const char *keywords[] = { "num_nodes", "edges_src", "edges_dst", "edge_labels", "node_labels", "num_edge_labels", "directed", nullptr };
+        unsigned long long num_nodes = 0;
+        PyObject *src_object = nullptr, *dst_object = nullptr, *labels_object = Py_None, *node_labels_object = Py_None, *num_labels_object = Py_None;
+        int directed = 1;
+        if( !PyArg_ParseTupleAndKeywords(args, kwargs, "KOO|OOOp", const_cast<char**>(keywords), &num_nodes, &src_object, &dst_object,
+                                         &labels_object, &node_labels_object, &num_labels_object, &directed) )
+            return -1;
+        if( num_nodes >= (1ULL << 32) - 1 ) {
+            PyErr_SetString(PyExc_ValueError, "too many nodes");
+            return -1;
+        }
+
+        unique_ptr<PyArrayObject, void(*)(PyArrayObject*)> src(nullptr, [](PyArrayObject *a) { Py_XDECREF(a); });
+        unique_ptr<PyArrayObject, void(*)(PyArrayObject*)> dst(nullptr, [](PyArrayObject *a) { Py_XDECREF(a); });
+        unique_ptr<PyArrayObject, void(*)(PyArrayObject*)> labels(nullptr, [](PyArrayObject *a) { Py_XDECREF(a); });
+        unique_ptr<PyArrayObject, void(*)(PyArrayObject*)> node_labels(nullptr, [](PyArrayObject *a) { Py_XDECREF(a); });
+        src.reset(as_array(src_object, NPY_UINT32, "edges_src"));
+        if( src == nullptr ) return -1;
+        dst.reset(as_array(dst_object, NPY_UINT32, "edges_dst"));
+        if( dst == nullptr ) return -1;
+        size_t num_edges = PyArray_SIZE(src.get());
+        if( size_t(PyArray_SIZE(dst.get())) != num_edges ) {
+            PyErr_SetString(PyExc_ValueError, "edges_src and edges_dst differ in length");
+            return -1;
+        }
+        if( labels_object != Py_None ) {
+            labels.reset(as_array(labels_object, NPY_UINT64, "edge_labels"));
+            if( labels == nullptr ) return -1;
+            if( size_t(PyArray_SIZE(labels.get())) != num_edges ) {
+                PyErr_SetString(PyExc_ValueError, "edge_labels and edges_src differ in length");
+                return -1;
+            }
+        }
+        if( node_labels_object != Py_None ) {
+            node_labels.reset(as_array(node_labels_object, NPY_UINT64, "node_labels"));
+            if( node_labels == nullptr ) return -1;
+            if( size_t(PyArray_SIZE(node_labels.get())) != num_nodes ) {
+                PyErr_SetString(PyExc_ValueError, "node_labels must have num_nodes entries");
+                return -1;
+            }
+        }
+        long long num_edge_labels = -1;
+        if( num_labels_object != Py_None ) {
+            num_edge_labels = PyLong_AsLongLong(num_labels_object);
+            if( PyErr_Occurred() ) return -1;
+        }
+
+        const Node *edges_src = static_cast<const Node*>(PyArray_DATA(src.get()));
+        const Node *edges_dst = static_cast<const Node*>(PyArray_DATA(dst.get()));
+        const Label *edge_labels = labels == nullptr ? nullptr : static_cast<const Label*>(PyArray_DATA(labels.get()));
+        const Label *node_label_data = node_labels == nullptr ? nullptr : static_cast<const Label*>(PyArray_DATA(node_labels.get()));
+        const char *error = nullptr;
+        GraphLibrary::CSRGraph *csr = nullptr;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            // Check nodes and labels, and build graph.
+            Label max_label = 0;
+            for( size_t e = 0; (e < num_edges) && (error == nullptr); ++e ) {
+                if( (edges_src[e] >= num_nodes) || (edges_dst[e] >= num_nodes) ) error = "node out of range";
+                if( edge_labels != nullptr ) max_label = max(max_label, edge_labels[e]);
+            }
+            if( num_edge_labels < 0 ) num_edge_labels = (edge_labels == nullptr) || (num_edges == 0) ? 1 : max_label + 1;
+            if( (error == nullptr) && (num_edges > 0) && (max_label >= Label(num_edge_labels)) ) error = "edge label out of range";
+            if( (error == nullptr) && (num_edge_labels > (1LL << 31)) ) error = "too many edge labels";
+            if( error == nullptr ) {
+                Labels node_label_vector = node_label_data == nullptr ? Labels(num_nodes, 1) : Labels(node_label_data, node_label_data + num_nodes);
+                if( directed && (edge_labels != nullptr) ) {
+                    csr = new GraphLibrary::CSRGraph(num_nodes, num_edges, edges_src, edges_dst, edge_labels, num_edge_labels, node_label_vector);
+                } else {
+                    Labels label_vector = edge_labels == nullptr ? Labels(num_edges, 0) : Labels(edge_labels, edge_labels + num_edges);
+                    csr = new GraphLibrary::CSRGraph(num_nodes, Nodes(edges_src, edges_src + num_edges), Nodes(edges_dst, edges_dst + num_edges),
+                                                     label_vector, num_edge_labels, node_label_vector, directed);
+                }
+            }
+        } catch( const bad_alloc& ) {
+            error = "out of memory";
+        }
+        Py_END_ALLOW_THREADS
+        if( error != nullptr ) {
+            PyErr_SetString(strcmp(error, "out of memory") == 0 ? PyExc_MemoryError : PyExc_ValueError, error);
+            return -1;
+        }
+        delete self->csr;
+        self->csr = csr;
+        return 0;
+    }
+
+    PyObject* Graph_stable_coloring(GraphObject *self, PyObject *args, PyObject *kwargs) {
+        static const char *keywords[] = { "node_labels", "normalize_colors", "exact_colors", "sparse_labels", "num_threads", "max_rounds", "time_budget", nullptr };
+        PyObject *node_labels_object = Py_None;
+        int normalize_colors = 0, exact_colors = 0, sparse_labels = 0;
+        unsigned num_threads = 1, max_rounds = 0;
+        double time_budget = 0;
+        if( !PyArg_ParseTupleAndKeywords(args, kwargs, "|OpppIId", const_cast<char**>(keywords), &node_labels_object,
+                                         &normalize_colors, &exact_colors, &sparse_labels, &num_threads, &max_rounds, &time_budget) )
+            return nullptr;
+        if( self->csr == nullptr ) {
+            PyErr_SetString(PyExc_RuntimeError, "graph not initialized");
+            return nullptr;
+        }
+        const GraphLibrary::CSRGraph &csr = *self->csr;
+
+        Labels node_labels = csr.get_node_labels();
+        if( node_labels_object != Py_None ) {
+            PyArrayObject *array = as_array(node_labels_object, NPY_UINT64, "node_labels");
+            if( array == nullptr ) return nullptr;
+            if( size_t(PyArray_SIZE(array)) != csr.get_num_nodes() ) {
+                Py_DECREF(array);
+                PyErr_SetString(PyExc_ValueError, "node_labels must have num_nodes entries");
+                return nullptr;
+            }
+            const Label *data = static_cast<const Label*>(PyArray_DATA(array));
+            node_labels.assign(data, data + csr.get_num_nodes());
+            Py_DECREF(array);
+        }
+
+        ColorRefinement::Options options;
+        options.normalize_colors = normalize_colors;
+        options.exact_colors = exact_colors || (num_threads > 1);
+        options.sparse_labels = sparse_labels;
+        options.num_threads = max(1U, num_threads);
+        options.max_rounds = max_rounds;
+        options.time_budget = time_budget;
+        ColorRefinement::Coloring coloring;
+        int num_iterations = 0;
+        bool out_of_memory = false;
+        Py_BEGIN_ALLOW_THREADS
+        try {
+            ColorRefinement::ColorRefinement cr(csr);
+            num_iterations = cr.compute_stable_coloring(coloring, node_labels, options);
+        } catch( const bad_alloc& ) {
+            out_of_memory = true;
+        }
+        Py_END_ALLOW_THREADS
+        if( out_of_memory ) return PyErr_NoMemory();
+
+        npy_intp dims[1] = { npy_intp(coloring.get_num_nodes()) };
+        PyObject *colors = PyArray_SimpleNew(1, dims, NPY_UINT64);
+        if( colors == nullptr ) return nullptr;
+        memcpy(PyArray_DATA(reinterpret_cast<PyArrayObject*>(colors)), coloring.node_to_color.data(), sizeof(Label) * coloring.get_num_nodes());
+        return Py_BuildValue("(iN)", num_iterations, colors);
+    }
+
+    PyObject* Graph_get_num_nodes(GraphObject *self, void*) {
+        return PyLong_FromSize_t(self->csr == nullptr ? 0 : self->csr->get_num_nodes());
+    }
+    PyObject* Graph_get_num_edges(GraphObject *self, void*) {
+        return PyLong_FromSize_t(self->csr == nullptr ? 0 : self->csr->get_num_edges());
+    }
+    PyObject* Graph_get_num_edge_labels(GraphObject *self, void*) {
+        return PyLong_FromSize_t(self->csr == nullptr ? 0 : self->csr->get_num_edge_labels());
+    }
+
+    PyMethodDef Graph_methods[] = {
+        { "stable_coloring", reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)(void)>(Graph_stable_coloring)), METH_VARARGS | METH_KEYWORDS,
+          "stable_coloring(node_labels=None, normalize_colors=False, exact_colors=False, sparse_labels=False, num_threads=1, max_rounds=0, time_budget=0)\n"
+          "Return (#iterations, colors) with the stable color of each node as a numpy uint64 array." },
+        { nullptr, nullptr, 0, nullptr }
+    };
+
+    PyGetSetDef Graph_getset[] = {
+        { "num_nodes", reinterpret_cast<getter>(Graph_get_num_nodes), nullptr, "number of nodes", nullptr },
+        { "num_edges", reinterpret_cast<getter>(Graph_get_num_edges), nullptr, "number of arcs (undirected edges count twice)", nullptr },
+        { "num_edge_labels", reinterpret_cast<getter>(Graph_get_num_edge_labels), nullptr, "number of edge labels", nullptr },
+        { nullptr, nullptr, nullptr, nullptr, nullptr }
+    };
+
+    PyTypeObject GraphType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+
+    PyModuleDef engine_module = {
+        PyModuleDef_HEAD_INIT,
+        "_engine",
+        "C++ color refinement engine.",
+        -1,
+        nullptr
+    };
+}
+
+PyMODINIT_FUNC PyInit__engine() {
+    import_array();
+    GraphType.tp_name = "color_refinement._engine.Graph";
+    GraphType.tp_doc = "Graph(num_nodes, edges_src, edges_dst, edge_labels=None, node_labels=None, num_edge_labels=None, directed=True)";
+    GraphType.tp_basicsize = sizeof(GraphObject);
+    GraphType.tp_flags = Py_TPFLAGS_DEFAULT;
+    GraphType.tp_new = PyType_GenericNew;
+    GraphType.tp_init = reinterpret_cast<initproc>(Graph_init);
+    GraphType.tp_dealloc = reinterpret_cast<destructor>(Graph_dealloc);
+    GraphType.tp_methods = Graph_methods;
+    GraphType.tp_getset = Graph_getset;
+    if( PyType_Ready(&GraphType) < 0 ) return nullptr;
+
+    PyObject *module = PyModule_Create(&engine_module);
+    if( module == nullptr ) return nullptr;
+    Py_INCREF(&GraphType);
+    if( PyModule_AddObject(module, "Graph", reinterpret_cast<PyObject*>(&GraphType)) < 0 ) {
+        Py_DECREF(&GraphType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,18 @@
+# Build the C++ engine of color_refinement in place:
+#
+#   $ cd python && python setup.py build_ext --inplace
+#
+# Without it, color_refinement falls back to the pure-Python refinement loop.
+
+import numpy
+from setuptools import Extension, setup
+
+engine = Extension('color_refinement._engine',
+                   sources=['color_refinement/engine.cpp', '../src/ColorRefinement.cpp'],
+                   include_dirs=['../src', numpy.get_include()],
+                   extra_compile_args=['-std=c++17', '-O3'],
+                   language='c++')
+
+setup(name='color_refinement',
+      packages=['color_refinement'],
+      ext_modules=[engine])
@@ -0,0 +1,37 @@
+# Tests of the C++ engine of color_refinement (built with setup.py build_ext
+# --inplace). Run from python/:
+#
+#   $ python -m unittest discover tests
+
+import unittest
+
+import numpy as np
+
+from color_refinement import have_engine, stable_coloring
+
+@unittest.skipUnless(have_engine(), 'C++ engine not built')
+class TestEngineArrays(unittest.TestCase):
+    # cycle of 6 nodes: all nodes get the same color
+    def test_int64_arrays(self):
+        edges_src = np.array([0, 1, 2, 3, 4, 5])
+        edges_dst = np.array([1, 2, 3, 4, 5, 0])
+        self.assertEqual(edges_src.dtype, np.int64)
+        num_iterations, colors = stable_coloring(6, edges_src, edges_dst, edge_labels=np.zeros(6, dtype=np.int64), node_labels=np.ones(6, dtype=np.int64))
+        self.assertEqual(len(set(colors)), 1)
+        _, expected = stable_coloring(6, edges_src.astype(np.uint32), edges_dst.astype(np.uint32))
+        self.assertTrue(np.array_equal(colors, expected))
+
+    def test_lists(self):
+        _, colors = stable_coloring(3, [0, 1], [1, 2])
+        self.assertEqual(len(set(colors)), 3)
+
+    def test_out_of_range(self):
+        with self.assertRaises(ValueError):
+            stable_coloring(3, np.array([0, -1]), np.array([1, 2]))
+        with self.assertRaises(ValueError):
+            stable_coloring(3, np.array([0, 1 << 32]), np.array([1, 2]))
+        with self.assertRaises(TypeError):
+            stable_coloring(3, np.array([0.5, 1.0]), np.array([1, 2]))
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,271 @@
+/**********************************************************************
+ * Compact binary graph format (ext .wlg).
+ *********************************************************************/
+
+#include <cstring>
+#include <fstream>
+#include "BinaryGraph.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace GraphLibrary {
+    namespace {
+        const char BINARY_GRAPH_MAGIC[8] = { 'W', 'L', 'G', 'R', 'A', 'P', 'H', '\0' };
+
+        inline uint64_t align(uint64_t offset) {
+            return (offset + 7) & ~uint64_t(7);
+        }
+
+        void write_section(ofstream &ofs, const void *data, size_t size, uint64_t offset) {
+            ofs.seekp(offset);
+            ofs.write(static_cast<const char*>(data), size);
+        }
+
+        // Whether a section of "count" items of "size" bytes at "offset" is
+        // aligned and within a file of "file_size" bytes (without overflows).
+        inline bool check_section(uint64_t offset, uint64_t count, uint64_t size, uint64_t file_size) {
+            return (offset % 8 == 0) && (offset <= file_size) && (count <= (file_size - offset) / size);
+        }
+
+        // Check header of binary file of given size: counts fit node and arc
+        // ids, and sections are within the file.
+        bool check_header(const BinaryHeader &header, size_t file_size, const string &filename, string &error) {
+            if( memcmp(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic)) != 0 ) {
+                error = "file '" + filename + "' is not a binary graph";
+                return false;
+            } else if( header.version != BINARY_GRAPH_VERSION ) {
+                error = "unsupported version " + to_string(header.version) + " of binary graph (expected " + to_string(BINARY_GRAPH_VERSION) + ")";
+                return false;
+            } else if( (header.file_size != file_size) ||
+                       (header.num_nodes >= uint64_t(Node(-1))) ||
+                       (header.num_arcs > uint64_t(Edge(-1))) ||
+                       (header.num_labels > uint64_t(uint(-1))) ||
+                       !check_section(header.node_colors_offset, header.num_nodes, sizeof(Label), file_size) ||
+                       !check_section(header.outbound_offsets_offset, header.num_nodes + 1, sizeof(Edge), file_size) ||
+                       !check_section(header.outbound_arcs_offset, header.num_arcs, sizeof(CSRGraph::Arc), file_size) ||
+                       !check_section(header.inbound_offsets_offset, header.num_nodes + 1, sizeof(Edge), file_size) ||
+                       !check_section(header.inbound_arcs_offset, header.num_arcs, sizeof(CSRGraph::Arc), file_size) ||
+                       !check_section(header.labels_offset, header.num_labels, sizeof(BinaryLabel), file_size) ||
+                       (header.names_offset > file_size) ) {
+                error = "binary graph '" + filename + "' is truncated or corrupted";
+                return false;
+            }
+            return true;
+        }
+
+        // Check CSR arrays of one direction: offsets are increasing from 0 to
+        // "num_arcs", and the arcs of each node have valid endpoints and
+        // labels in increasing order.
+        bool check_arrays(const Edge *offsets, const CSRGraph::Arc *arcs, uint64_t num_nodes, uint64_t num_arcs, uint64_t num_labels) {
+            if( (offsets[0] != 0) || (offsets[num_nodes] != num_arcs) ) return false;
+            for( uint64_t v = 0; v < num_nodes; ++v ) {
+                if( offsets[v] > offsets[v + 1] ) return false;
+                for( Edge e = offsets[v]; e < offsets[v + 1]; ++e ) {
+                    if( (arcs[e].node >= num_nodes) || (arcs[e].label >= num_labels) ) return false;
+                    if( (e > offsets[v]) && (arcs[e].label < arcs[e - 1].label) ) return false;
+                }
+            }
+            return true;
+        }
+
+        // Graph over image "data" of a binary file (8-byte aligned), which is
+        // kept alive by "owner".
+        bool read_binary_image(const char *data, size_t size, shared_ptr<const void> owner, const string &filename, BinaryGraph &binary_graph, string &error) {
+            // Check header.
+            BinaryHeader header;
+            if( size < sizeof(header) ) {
+                error = "file '" + filename + "' is not a binary graph";
+                return false;
+            }
+            memcpy(&header, data, sizeof(header));
+            if( !check_header(header, size, filename, error) ) return false;
+
+            // Check arrays (inbound ones are not used by undirected views)
+            // and names of labels.
+            bool directed = (header.flags & 1) != 0;
+            const Label *node_colors = reinterpret_cast<const Label*>(data + header.node_colors_offset);
+            const Edge *outbound_offsets = reinterpret_cast<const Edge*>(data + header.outbound_offsets_offset);
+            const Edge *inbound_offsets = reinterpret_cast<const Edge*>(data + header.inbound_offsets_offset);
+            const CSRGraph::Arc *outbound_arcs = reinterpret_cast<const CSRGraph::Arc*>(data + header.outbound_arcs_offset);
+            const CSRGraph::Arc *inbound_arcs = reinterpret_cast<const CSRGraph::Arc*>(data + header.inbound_arcs_offset);
+            const BinaryLabel *labels = reinterpret_cast<const BinaryLabel*>(data + header.labels_offset);
+            bool ok = check_arrays(outbound_offsets, outbound_arcs, header.num_nodes, header.num_arcs, header.num_labels) &&
+                      (!directed || check_arrays(inbound_offsets, inbound_arcs, header.num_nodes, header.num_arcs, header.num_labels));
+            uint64_t names_size = size - header.names_offset;
+            for( size_t i = 0; ok && (i < header.num_labels); ++i )
+                ok = (labels[i].name_offset <= names_size) && (labels[i].name_length <= names_size - labels[i].name_offset);
+            if( !ok ) {
+                error = "binary graph '" + filename + "' is truncated or corrupted";
+                return false;
+            }
+
+            // Setup CSR view over arrays of image.
+            binary_graph = BinaryGraph();
+            binary_graph.mapping = owner;
+            binary_graph.num_bytes = size;
+            binary_graph.csr.reset(new CSRGraph(header.num_nodes,
+                                                header.num_arcs,
+                                                header.num_labels,
+                                                Labels(node_colors, node_colors + header.num_nodes),
+                                                directed,
+                                                outbound_offsets,
+                                                outbound_arcs,
+                                                inbound_offsets,
+                                                inbound_arcs,
+                                                owner));
+
+            // Labels.
+            for( size_t i = 0; i < header.num_labels; ++i ) {
+                binary_graph.label_indices.push_back(labels[i].index);
+                binary_graph.label_names.emplace_back(data + header.names_offset + labels[i].name_offset, labels[i].name_length);
+                binary_graph.chosen_labels.push_back(labels[i].chosen != 0);
+            }
+            return true;
+        }
+    }
+
+    bool write_binary_file(const string &filename, const LPGraph &lp_graph, string &error) {
+        static_assert(sizeof(CSRGraph::Arc) == 8, "unexpected size of arcs");
+        static_assert(sizeof(Label) == 8, "unexpected size of labels");
+
+        // Number labels in order of first occurrence among the edges, as wl
+        // does for clingo files (labels without edges are not stored).
+        map<uint, uint> remap_label;
+        vector<BinaryLabel> labels;
+        string names;
+        Labels edge_labels(lp_graph.edge_labels.size());
+        for( size_t i = 0; i < edge_labels.size(); ++i ) {
+            uint index = lp_graph.edge_labels[i];
+            if( remap_label.find(index) == remap_label.end() ) {
+                const string &name = lp_graph.label_names.at(index);
+                uint32_t chosen = lp_graph.chosen_labels.find(index) != lp_graph.chosen_labels.end() ? 1 : 0;
+                remap_label.emplace(index, labels.size());
+                labels.push_back(BinaryLabel{ index, chosen, names.size(), name.size() });
+                names += name;
+            }
+            edge_labels[i] = remap_label[index];
+        }
+        CSRGraph csr(lp_graph.num_nodes, lp_graph.edges_src, lp_graph.edges_dst, edge_labels, labels.size(), lp_graph.node_colors);
+
+        // Setup header with offsets of sections.
+        BinaryHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic));
+        header.version = BINARY_GRAPH_VERSION;
+        header.flags = csr.directed() ? 1 : 0;
+        header.num_nodes = csr.get_num_nodes();
+        header.num_arcs = csr.get_num_edges();
+        header.num_labels = labels.size();
+        header.node_colors_offset = align(sizeof(header));
+        header.outbound_offsets_offset = align(header.node_colors_offset + sizeof(Label) * header.num_nodes);
+        header.outbound_arcs_offset = align(header.outbound_offsets_offset + sizeof(Edge) * (1 + header.num_nodes));
+        header.inbound_offsets_offset = align(header.outbound_arcs_offset + sizeof(CSRGraph::Arc) * header.num_arcs);
+        header.inbound_arcs_offset = align(header.inbound_offsets_offset + sizeof(Edge) * (1 + header.num_nodes));
+        header.labels_offset = align(header.inbound_arcs_offset + sizeof(CSRGraph::Arc) * header.num_arcs);
+        header.names_offset = align(header.labels_offset + sizeof(BinaryLabel) * header.num_labels);
+        header.file_size = header.names_offset + names.size();
+
+        ofstream ofs(filename, ofstream::out | ofstream::binary | ofstream::trunc);
+        if( !ofs.is_open() ) {
+            error = "opening file '" + filename + "'";
+            return false;
+        }
+        write_section(ofs, &header, sizeof(header), 0);
+        write_section(ofs, csr.get_node_labels().data(), sizeof(Label) * header.num_nodes, header.node_colors_offset);
+        write_section(ofs, csr.get_outbound_offsets(), sizeof(Edge) * (1 + header.num_nodes), header.outbound_offsets_offset);
+        write_section(ofs, csr.get_outbound_arcs(), sizeof(CSRGraph::Arc) * header.num_arcs, header.outbound_arcs_offset);
+        write_section(ofs, csr.get_inbound_offsets(), sizeof(Edge) * (1 + header.num_nodes), header.inbound_offsets_offset);
+        write_section(ofs, csr.get_inbound_arcs(), sizeof(CSRGraph::Arc) * header.num_arcs, header.inbound_arcs_offset);
+        write_section(ofs, labels.data(), sizeof(BinaryLabel) * header.num_labels, header.labels_offset);
+        write_section(ofs, names.data(), names.size(), header.names_offset);
+        // Trailing sections may be empty, so pad the file to its size.
+        ofs.seekp(0, ofstream::end);
+        for( uint64_t pos = ofs.tellp(); pos < header.file_size; ++pos )
+            ofs.put('\0');
+        ofs.close();
+        if( ofs.fail() ) {
+            error = "writing file '" + filename + "'";
+            return false;
+        }
+        return true;
+    }
+
+    bool read_binary_file(const string &filename, BinaryGraph &binary_graph, string &error) {
+        shared_ptr<MappedFile> file = make_shared<MappedFile>();
+        if( !file->open(filename, false) ) {
+            error = "opening file '" + filename + "'";
+            return false;
+        }
+        return read_binary_image(file->data(), file->size(), file, filename, binary_graph, error);
+    }
+
+    bool read_binary_data(shared_ptr<const string> data, BinaryGraph &binary_graph, string &error) {
+        return read_binary_image(data->data(), data->size(), data, "<data>", binary_graph, error);
+    }
+
+    CSRGraph make_csr_graph(const BinaryGraph &binary_graph, bool uniform_initial_coloring, bool use_chosen_labels, bool use_label_indices) {
+        const CSRGraph &csr = *binary_graph.csr;
+        Labels node_labels(uniform_initial_coloring ? Labels(csr.get_num_nodes(), 1) : csr.get_node_labels());
+        bool all_chosen = true;
+        for( bool chosen : binary_graph.chosen_labels )
+            all_chosen = all_chosen && chosen;
+
+        if( use_label_indices || (use_chosen_labels && !all_chosen) ) {
+            // Kept labels are renumbered in order (of first occurrence), or
+            // mapped to their label indices.
+            vector<uint> new_label(csr.get_num_edge_labels(), uint(-1));
+            uint num_edge_labels = 0;
+            for( uint label = 0; label < csr.get_num_edge_labels(); ++label ) {
+                if( use_chosen_labels && !binary_graph.chosen_labels[label] ) continue;
+                new_label[label] = use_label_indices ? binary_graph.label_indices[label] : num_edge_labels;
+                num_edge_labels = max(num_edge_labels, new_label[label] + 1);
+            }
+            CSRGraph filtered = csr.remap_labels(new_label, num_edge_labels);
+            return CSRGraph(filtered.get_num_nodes(),
+                            filtered.get_num_edges(),
+                            filtered.get_num_edge_labels(),
+                            node_labels,
+                            filtered.directed(),
+                            filtered.get_outbound_offsets(),
+                            filtered.get_outbound_arcs(),
+                            filtered.get_inbound_offsets(),
+                            filtered.get_inbound_arcs(),
+                            make_shared<CSRGraph>(move(filtered)));
+        } else {
+            return CSRGraph(csr.get_num_nodes(),
+                            csr.get_num_edges(),
+                            csr.get_num_edge_labels(),
+                            node_labels,
+                            csr.directed(),
+                            csr.get_outbound_offsets(),
+                            csr.get_outbound_arcs(),
+                            csr.get_inbound_offsets(),
+                            csr.get_inbound_arcs(),
+                            binary_graph.mapping);
+        }
+    }
+
+    bool read_binary_header(const string &filename, BinaryHeader &header, vector<BinaryLabel> &labels, string &error) {
+        ifstream ifs(filename, ifstream::in | ifstream::binary);
+        if( !ifs.is_open() ) {
+            error = "opening file '" + filename + "'";
+            return false;
+        }
+        ifs.seekg(0, ifstream::end);
+        size_t file_size = ifs.tellg();
+        ifs.seekg(0);
+        if( (file_size < sizeof(header)) || !ifs.read(reinterpret_cast<char*>(&header), sizeof(header)) ) {
+            error = "file '" + filename + "' is not a binary graph";
+            return false;
+        }
+        if( !check_header(header, file_size, filename, error) ) return false;
+        labels.resize(header.num_labels);
+        ifs.seekg(header.labels_offset);
+        if( !ifs.read(reinterpret_cast<char*>(labels.data()), sizeof(BinaryLabel) * header.num_labels) ) {
+            error = "reading file '" + filename + "'";
+            return false;
+        }
+        return true;
+    }
+}
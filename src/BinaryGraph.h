@@ -0,0 +1,101 @@
+/**********************************************************************
+ * Compact binary graph format (ext .wlg).
+ *
+ * A file holds a header followed by 8-byte aligned sections: initial node
+ * colors, outbound and inbound CSR arrays (see CSRGraph), a label table
+ * with the original label index and chosen flag of each label, and the
+ * label names. Labels are numbered in order of first occurrence among the
+ * edges of the clingo file, as wl does for clingo files, so both formats
+ * give the same colors; labels without edges are not stored. The file is memory-mapped when loaded, and its CSR arrays
+ * are used in place. Integers are stored in host byte order.
+ *
+ * Layout of version 1:
+ *
+ *   BinaryHeader
+ *   node colors        uint64[num_nodes]
+ *   outbound offsets   uint32[num_nodes + 1]
+ *   outbound arcs      { uint32 node, uint32 label }[num_arcs]
+ *   inbound offsets    uint32[num_nodes + 1]
+ *   inbound arcs       { uint32 node, uint32 label }[num_arcs]
+ *   labels             BinaryLabel[num_labels]
+ *   names              char[]
+ *********************************************************************/
+
+#ifndef BINARY_GRAPH_H
+#define BINARY_GRAPH_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include "CSRGraph.h"
+#include "LPReader.h"
+
+namespace GraphLibrary {
+    const uint32_t BINARY_GRAPH_VERSION = 1;
+
+    struct BinaryHeader {
+        char magic[8];                  // "WLGRAPH\0"
+        uint32_t version;
+        uint32_t flags;                 // bit 0: directed
+        uint64_t num_nodes;
+        uint64_t num_arcs;              // arcs in each direction
+        uint64_t num_labels;
+        uint64_t node_colors_offset;
+        uint64_t outbound_offsets_offset;
+        uint64_t outbound_arcs_offset;
+        uint64_t inbound_offsets_offset;
+        uint64_t inbound_arcs_offset;
+        uint64_t labels_offset;
+        uint64_t names_offset;
+        uint64_t file_size;
+    };
+
+    struct BinaryLabel {
+        uint32_t index;                 // label index in labelname/2
+        uint32_t chosen;                // 1 if label is chosen
+        uint64_t name_offset;           // offset in names section
+        uint64_t name_length;
+    };
+
+    // Graph loaded from a binary file. The CSR view refers to the mapped file.
+    struct BinaryGraph {
+        std::shared_ptr<const void> mapping;
+        std::unique_ptr<CSRGraph> csr;
+        // Label index (as in labelname/2) of each label in the CSR view.
+        std::vector<uint> label_indices;
+        std::vector<std::string> label_names;
+        std::vector<bool> chosen_labels;
+        size_t num_bytes;
+
+        BinaryGraph() : num_bytes(0) { }
+    };
+
+    // Write graph of clingo file in binary format. Labels are numbered in
+    // order of first occurrence among the edges, as in make_remapped_csr_graph().
+    bool write_binary_file(const std::string &filename, const LPGraph &lp_graph, std::string &error);
+
+    // Map binary file. Returns false and sets "error" if the file cannot be
+    // read or is not a valid binary graph.
+    bool read_binary_file(const std::string &filename, BinaryGraph &binary_graph, std::string &error);
+
+    // Same, for the image of a binary file in memory (e.g., received over a
+    // socket). The CSR view refers to "data", which is kept alive.
+    bool read_binary_data(std::shared_ptr<const std::string> data, BinaryGraph &binary_graph, std::string &error);
+
+    // Read and check header and labels of binary file without mapping it
+    // (for streaming its sections). Returns false and sets "error" if the
+    // file cannot be read or is not a valid binary graph.
+    bool read_binary_header(const std::string &filename, BinaryHeader &header, std::vector<BinaryLabel> &labels, std::string &error);
+
+    // Get CSR view of binary graph. The view is zero-copy unless edges with
+    // labels that are not chosen must be dropped (if "use_chosen_labels" is
+    // set); then a filtered copy is built. If "use_label_indices" is set,
+    // edge labels are the label indices of the clingo file (a copy is built),
+    // as in make_csr_graph() for clingo files.
+    CSRGraph make_csr_graph(const BinaryGraph &binary_graph, bool uniform_initial_coloring, bool use_chosen_labels, bool use_label_indices = false);
+}
+
+#endif // BINARY_GRAPH_H
+
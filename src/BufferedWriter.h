@@ -0,0 +1,85 @@
+/**********************************************************************
+ * Buffered output to a file.
+ *
+ * Output is accumulated in a buffer that is written to the file when full
+ * (or on flush), so no system call or flush is done per line. The output
+ * can also be appended to a string (e.g., to be written later in order).
+ *********************************************************************/
+
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Graph.h"
+
+namespace GraphLibrary {
+    class BufferedWriter {
+      public:
+        // Ctors/dtor. The writer does not close "file", and appends to "str".
+        explicit BufferedWriter(FILE *file, size_t buffer_size = 1 << 20)
+          : m_file(file), m_string(nullptr), m_buffer(std::max<size_t>(buffer_size, 64)), m_size(0) {
+        }
+        explicit BufferedWriter(std::string *str, size_t buffer_size = 1 << 16)
+          : m_file(nullptr), m_string(str), m_buffer(std::max<size_t>(buffer_size, 64)), m_size(0) {
+        }
+        BufferedWriter(const BufferedWriter &writer) = delete;
+        BufferedWriter& operator=(const BufferedWriter &writer) = delete;
+        ~BufferedWriter() {
+            if( m_size > 0 ) flush();
+        }
+
+        // Write buffer to file (or string). Returns false on I/O error.
+        bool flush() {
+            if( m_string != nullptr ) {
+                m_string->append(m_buffer.data(), m_size);
+                m_size = 0;
+                return true;
+            }
+            bool ok = fwrite(m_buffer.data(), 1, m_size, m_file) == m_size;
+            m_size = 0;
+            return ok && (fflush(m_file) == 0);
+        }
+
+        void put(const char *data, size_t size) {
+            while( size > 0 ) {
+                if( m_size == m_buffer.size() ) flush();
+                size_t n = std::min(size, m_buffer.size() - m_size);
+                memcpy(m_buffer.data() + m_size, data, n);
+                m_size += n;
+                data += n;
+                size -= n;
+            }
+        }
+        void put(const char *str) {
+            put(str, strlen(str));
+        }
+        void put(char c) {
+            if( m_size == m_buffer.size() ) flush();
+            m_buffer[m_size++] = c;
+        }
+        void put_uint(ulong value) {
+            char digits[20];
+            int n = 0;
+            do {
+                digits[n++] = '0' + value % 10;
+                value /= 10;
+            } while( value > 0 );
+            if( m_buffer.size() - m_size < size_t(n) ) flush();
+            while( n > 0 )
+                m_buffer[m_size++] = digits[--n];
+        }
+
+      private:
+        FILE *m_file;
+        std::string *m_string;
+        std::vector<char> m_buffer;
+        size_t m_size;
+    };
+}
+
+#endif // BUFFERED_WRITER_H
+
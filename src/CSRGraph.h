@@ -0,0 +1,373 @@
+/**********************************************************************
+ * Immutable compressed-sparse-row (CSR) view of a graph.
+ *
+ * For each node, the outbound and inbound arcs are stored contiguously in
+ * two arrays, each arc holding the neighbor and the edge label inline.
+ * Arcs of a node are grouped by edge label (in increasing order), so that
+ * the refinement loop reads each (direction, label) group as a single run
+ * without going through edge ids.
+ *
+ * The arrays are either owned by the view or external (e.g., in a mapped
+ * binary graph file) and kept alive by a shared owner.
+ *
+ * An undirected edge {v, w} is an arc from v to w and an arc from w to v,
+ * so the inbound arcs of a node are its outbound arcs. Undirected views
+ * only store the outbound arrays, and the inbound arrays alias them.
+ *********************************************************************/
+
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+#include "Graph.h"
+
+namespace GraphLibrary {
+    class CSRGraph {
+      public:
+        // Neighbor and edge label of an arc.
+        struct Arc {
+            Node node;
+            uint label;
+        };
+
+        // Ctors/dtor. Edge labels must be in { 0, ..., num_edge_labels - 1 },
+        // and the two edges of "graph" added for an undirected edge must have
+        // the same label.
+        CSRGraph(const Graph &graph, const Labels &edge_labels, uint num_edge_labels)
+          : m_num_nodes(graph.get_num_nodes()),
+            m_num_edge_labels(num_edge_labels),
+            m_node_labels(graph.get_node_labels()),
+            m_directed(graph.directed()) {
+            size_t num_edges = graph.get_num_edges();
+            assert(edge_labels.size() == num_edges);
+            Nodes edges_src(num_edges), edges_dst(num_edges);
+            for( Edge e = 0; e < num_edges; ++e ) {
+                edges_src[e] = graph.get_src(e);
+                edges_dst[e] = graph.get_dst(e);
+            }
+            build(edges_src, edges_dst, edge_labels);
+        }
+        CSRGraph(uint num_nodes,
+                 const Nodes &edges_src,
+                 const Nodes &edges_dst,
+                 const Labels &edge_labels,
+                 uint num_edge_labels,
+                 const Labels &node_labels,
+                 bool directed = true)
+          : m_num_nodes(num_nodes),
+            m_num_edge_labels(num_edge_labels),
+            m_node_labels(node_labels),
+            m_directed(directed) {
+            assert(edges_src.size() == edges_dst.size());
+            assert(edges_src.size() == edge_labels.size());
+            if( directed ) {
+                build(edges_src, edges_dst, edge_labels);
+            } else {
+                // Undirected edges are stored as two arcs, as in Graph::add_edge().
+                Nodes src(edges_src), dst(edges_dst);
+                Labels labels(edge_labels);
+                src.insert(src.end(), edges_dst.begin(), edges_dst.end());
+                dst.insert(dst.end(), edges_src.begin(), edges_src.end());
+                labels.insert(labels.end(), edge_labels.begin(), edge_labels.end());
+                build(src, dst, labels);
+            }
+        }
+
+        // Directed graph over external edge arrays (e.g., numpy arrays), which
+        // are only read during construction.
+        CSRGraph(uint num_nodes,
+                 size_t num_edges,
+                 const Node *edges_src,
+                 const Node *edges_dst,
+                 const Label *edge_labels,
+                 uint num_edge_labels,
+                 const Labels &node_labels)
+          : m_num_nodes(num_nodes),
+            m_num_edge_labels(num_edge_labels),
+            m_node_labels(node_labels),
+            m_directed(true) {
+            build(num_edges, edges_src, edges_dst, edge_labels);
+        }
+
+        // View over external arrays, which "owner" keeps alive. Inbound arrays
+        // are not read for undirected views.
+        CSRGraph(size_t num_nodes,
+                 size_t num_arcs,
+                 uint num_edge_labels,
+                 const Labels &node_labels,
+                 bool directed,
+                 const Edge *outbound_offsets,
+                 const Arc *outbound_arcs,
+                 const Edge *inbound_offsets,
+                 const Arc *inbound_arcs,
+                 std::shared_ptr<const void> owner)
+          : m_num_nodes(num_nodes),
+            m_num_arcs(num_arcs),
+            m_num_edge_labels(num_edge_labels),
+            m_node_labels(node_labels),
+            m_directed(directed),
+            m_owner(owner),
+            m_outbound_offsets(outbound_offsets),
+            m_outbound_arcs(outbound_arcs),
+            m_inbound_offsets(directed ? inbound_offsets : outbound_offsets),
+            m_inbound_arcs(directed ? inbound_arcs : outbound_arcs) {
+        }
+
+        CSRGraph(const CSRGraph &graph)
+          : m_num_nodes(graph.m_num_nodes),
+            m_num_arcs(graph.m_num_arcs),
+            m_num_edge_labels(graph.m_num_edge_labels),
+            m_node_labels(graph.m_node_labels),
+            m_directed(graph.m_directed),
+            m_owner(graph.m_owner),
+            m_outbound_offsets(graph.m_outbound_offsets),
+            m_outbound_arcs(graph.m_outbound_arcs),
+            m_inbound_offsets(graph.m_inbound_offsets),
+            m_inbound_arcs(graph.m_inbound_arcs),
+            m_storage_offsets(graph.m_storage_offsets),
+            m_storage_arcs(graph.m_storage_arcs) {
+            if( m_owner == nullptr ) bind();
+        }
+        CSRGraph(CSRGraph &&graph)
+          : m_num_nodes(graph.m_num_nodes),
+            m_num_arcs(graph.m_num_arcs),
+            m_num_edge_labels(graph.m_num_edge_labels),
+            m_node_labels(std::move(graph.m_node_labels)),
+            m_directed(graph.m_directed),
+            m_owner(std::move(graph.m_owner)),
+            m_outbound_offsets(graph.m_outbound_offsets),
+            m_outbound_arcs(graph.m_outbound_arcs),
+            m_inbound_offsets(graph.m_inbound_offsets),
+            m_inbound_arcs(graph.m_inbound_arcs),
+            m_storage_offsets(std::move(graph.m_storage_offsets)),
+            m_storage_arcs(std::move(graph.m_storage_arcs)) {
+        }
+        ~CSRGraph() { }
+
+        // Get view with the arcs whose label is kept. Kept labels are renumbered
+        // into { 0, ..., #kept - 1 } in increasing order.
+        CSRGraph filter_labels(const std::vector<bool> &keep_label) const {
+            std::vector<uint> new_label(m_num_edge_labels, uint(-1));
+            uint num_kept = 0;
+            for( uint label = 0; label < m_num_edge_labels; ++label ) {
+                if( keep_label[label] ) new_label[label] = num_kept++;
+            }
+            return remap_labels(new_label, num_kept);
+        }
+
+        // Get view where each label l becomes new_label[l] in { 0, ...,
+        // num_edge_labels - 1 }, dropping arcs with new label uint(-1). If the
+        // map is not increasing on kept labels, the arcs of each node are
+        // grouped by label again (keeping their order within each group).
+        CSRGraph remap_labels(const std::vector<uint> &new_label, uint num_edge_labels) const {
+            bool increasing = true;
+            for( uint label = 0, last = 0; label < m_num_edge_labels; ++label ) {
+                if( new_label[label] == uint(-1) ) continue;
+                increasing = increasing && (new_label[label] >= last);
+                last = new_label[label];
+            }
+            CSRGraph graph(*this, num_edge_labels);
+            for( int direction = 0; direction < (m_directed ? 2 : 1); ++direction ) {
+                const Edge *offsets = direction == 0 ? m_outbound_offsets : m_inbound_offsets;
+                const Arc *arcs = direction == 0 ? m_outbound_arcs : m_inbound_arcs;
+                std::vector<Edge> &new_offsets = graph.m_storage_offsets[direction];
+                std::vector<Arc> &new_arcs = graph.m_storage_arcs[direction];
+                new_offsets.assign(1, 0);
+                for( size_t v = 0; v < m_num_nodes; ++v ) {
+                    for( const Arc *a = arcs + offsets[v]; a != arcs + offsets[v + 1]; ++a ) {
+                        uint label = new_label[a->label];
+                        if( label != uint(-1) ) {
+                            assert(label < num_edge_labels);
+                            new_arcs.push_back(Arc{ a->node, label });
+                        }
+                    }
+                    if( !increasing ) {
+                        std::stable_sort(new_arcs.begin() + new_offsets.back(), new_arcs.end(),
+                                         [](const Arc &a, const Arc &b) { return a.label < b.label; });
+                    }
+                    new_offsets.push_back(new_arcs.size());
+                }
+            }
+            graph.m_num_arcs = graph.m_storage_arcs[0].size();
+            graph.bind();
+            return graph;
+        }
+
+        // Get view where each node v becomes new_id[v], a permutation of the
+        // nodes. Node labels move with the nodes, and arcs keep their order.
+        CSRGraph permute_nodes(const Nodes &new_id) const {
+            assert(new_id.size() == m_num_nodes);
+            CSRGraph graph(*this, m_num_edge_labels);
+            for( size_t v = 0; v < m_num_nodes; ++v )
+                graph.m_node_labels[new_id[v]] = m_node_labels[v];
+            for( int direction = 0; direction < (m_directed ? 2 : 1); ++direction ) {
+                const Edge *offsets = direction == 0 ? m_outbound_offsets : m_inbound_offsets;
+                const Arc *arcs = direction == 0 ? m_outbound_arcs : m_inbound_arcs;
+                std::vector<Edge> &new_offsets = graph.m_storage_offsets[direction];
+                std::vector<Arc> &new_arcs = graph.m_storage_arcs[direction];
+                new_offsets.assign(m_num_nodes + 1, 0);
+                for( size_t v = 0; v < m_num_nodes; ++v )
+                    new_offsets[new_id[v] + 1] = offsets[v + 1] - offsets[v];
+                for( size_t v = 0; v < m_num_nodes; ++v )
+                    new_offsets[v + 1] += new_offsets[v];
+                new_arcs.resize(m_num_arcs);
+                for( size_t v = 0; v < m_num_nodes; ++v ) {
+                    Arc *new_arc = new_arcs.data() + new_offsets[new_id[v]];
+                    for( const Arc *a = arcs + offsets[v]; a != arcs + offsets[v + 1]; ++a )
+                        *new_arc++ = Arc{ new_id[a->node], a->label };
+                }
+            }
+            graph.m_num_arcs = m_num_arcs;
+            graph.bind();
+            return graph;
+        }
+
+        // Get number of nodes/edges/edge labels in graph.
+        size_t get_num_nodes() const {
+            return m_num_nodes;
+        }
+        size_t get_num_edges() const {
+            return m_num_arcs;
+        }
+        uint get_num_edge_labels() const {
+            return m_num_edge_labels;
+        }
+
+        // Get node labels.
+        const Labels& get_node_labels() const {
+            return m_node_labels;
+        }
+
+        // Get arcs of node "v" as ranges [begin, end).
+        const Arc* outbound_begin(const Node v) const {
+            return m_outbound_arcs + m_outbound_offsets[v];
+        }
+        const Arc* outbound_end(const Node v) const {
+            return m_outbound_arcs + m_outbound_offsets[v + 1];
+        }
+        const Arc* inbound_begin(const Node v) const {
+            return m_inbound_arcs + m_inbound_offsets[v];
+        }
+        const Arc* inbound_end(const Node v) const {
+            return m_inbound_arcs + m_inbound_offsets[v + 1];
+        }
+
+        // Get raw arrays: offsets have get_num_nodes() + 1 entries, and
+        // arcs have get_num_edges() entries.
+        const Edge* get_outbound_offsets() const {
+            return m_outbound_offsets;
+        }
+        const Arc* get_outbound_arcs() const {
+            return m_outbound_arcs;
+        }
+        const Edge* get_inbound_offsets() const {
+            return m_inbound_offsets;
+        }
+        const Arc* get_inbound_arcs() const {
+            return m_inbound_arcs;
+        }
+
+        // Get degree of node "v".
+        size_t get_out_degree(const Node v) const {
+            return m_outbound_offsets[v + 1] - m_outbound_offsets[v];
+        }
+        size_t get_in_degree(const Node v) const {
+            return m_inbound_offsets[v + 1] - m_inbound_offsets[v];
+        }
+
+        // Whether graph is directed/undirected
+        bool directed() const {
+            return m_directed;
+        }
+        bool undirected() const {
+            return !directed();
+        }
+
+        // Bytes used by the arrays owned by the view.
+        size_t get_memory_usage() const {
+            return sizeof(Edge) * (m_storage_offsets[0].capacity() + m_storage_offsets[1].capacity()) +
+                   sizeof(Arc) * (m_storage_arcs[0].capacity() + m_storage_arcs[1].capacity()) +
+                   sizeof(Label) * m_node_labels.capacity();
+        }
+
+      private:
+        size_t m_num_nodes;
+        size_t m_num_arcs;
+        uint m_num_edge_labels;
+        Labels m_node_labels;
+        bool m_directed;
+
+        // Arrays of the view: they point into storage or into the memory of owner.
+        std::shared_ptr<const void> m_owner;
+        const Edge *m_outbound_offsets;
+        const Arc *m_outbound_arcs;
+        const Edge *m_inbound_offsets;
+        const Arc *m_inbound_arcs;
+
+        // Owned arrays for outbound (0) and inbound (1) arcs (only outbound
+        // ones for undirected views).
+        std::vector<Edge> m_storage_offsets[2];
+        std::vector<Arc> m_storage_arcs[2];
+
+        // Empty view with same nodes as "graph", for remap_labels() and
+        // permute_nodes().
+        CSRGraph(const CSRGraph &graph, uint num_edge_labels)
+          : m_num_nodes(graph.m_num_nodes),
+            m_num_arcs(0),
+            m_num_edge_labels(num_edge_labels),
+            m_node_labels(graph.m_node_labels),
+            m_directed(graph.m_directed) {
+        }
+
+        void bind() {
+            m_outbound_offsets = m_storage_offsets[0].data();
+            m_outbound_arcs = m_storage_arcs[0].data();
+            m_inbound_offsets = m_directed ? m_storage_offsets[1].data() : m_outbound_offsets;
+            m_inbound_arcs = m_directed ? m_storage_arcs[1].data() : m_outbound_arcs;
+        }
+
+        // Fill arcs of one direction: arcs are bucketed by "from" node, and
+        // within each node by label, using two stable counting sorts.
+        void fill(size_t num_edges, const Node *from, const Node *to, const std::vector<Edge> &by_label,
+                  std::vector<Edge> &offsets, std::vector<Arc> &arcs, const Label *edge_labels) const {
+            offsets.assign(m_num_nodes + 1, 0);
+            for( Edge e = 0; e < num_edges; ++e ) {
+                assert(from[e] < m_num_nodes);
+                ++offsets[from[e] + 1];
+            }
+            for( size_t v = 0; v < m_num_nodes; ++v )
+                offsets[v + 1] += offsets[v];
+            std::vector<Edge> next(offsets.begin(), offsets.end() - 1);
+            arcs.resize(num_edges);
+            for( Edge e : by_label )
+                arcs[next[from[e]]++] = Arc{ to[e], static_cast<uint>(edge_labels[e]) };
+        }
+
+        void build(const Nodes &edges_src, const Nodes &edges_dst, const Labels &edge_labels) {
+            build(edges_src.size(), edges_src.data(), edges_dst.data(), edge_labels.data());
+        }
+        void build(size_t num_edges, const Node *edges_src, const Node *edges_dst, const Label *edge_labels) {
+            std::vector<Edge> label_offsets(m_num_edge_labels + 1, 0);
+            for( Edge e = 0; e < num_edges; ++e ) {
+                assert(edge_labels[e] < m_num_edge_labels);
+                ++label_offsets[edge_labels[e] + 1];
+            }
+            for( uint i = 0; i < m_num_edge_labels; ++i )
+                label_offsets[i + 1] += label_offsets[i];
+            std::vector<Edge> by_label(num_edges);
+            for( Edge e = 0; e < num_edges; ++e )
+                by_label[label_offsets[edge_labels[e]]++] = e;
+
+            m_num_arcs = num_edges;
+            fill(num_edges, edges_src, edges_dst, by_label, m_storage_offsets[0], m_storage_arcs[0], edge_labels);
+            if( m_directed ) fill(num_edges, edges_dst, edges_src, by_label, m_storage_offsets[1], m_storage_arcs[1], edge_labels);
+            bind();
+        }
+    };
+}
+
+#endif // CSR_GRAPH_H
+
@@ -0,0 +1,216 @@
+/**********************************************************************
+ * Canonical labeling and automorphism group by individualization and
+ * refinement.
+ *********************************************************************/
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include "CanonicalLabeling.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    namespace {
+        Node find(Nodes &parent, Node v) {
+            while( parent[v] != v ) {
+                parent[v] = parent[parent[v]];
+                v = parent[v];
+            }
+            return v;
+        }
+
+        // Merge orbits of nodes under "generator", keeping smallest node as root.
+        void merge_orbits(Nodes &parent, const Nodes &generator) {
+            for( Node v = 0; v < generator.size(); ++v ) {
+                Node a = find(parent, v), b = find(parent, generator[v]);
+                if( a != b ) parent[max(a, b)] = min(a, b);
+            }
+        }
+    }
+
+    void CanonicalLabeling::compute() {
+        size_t n = m_csr.get_num_nodes();
+        m_path.clear();
+        m_first_path.clear();
+        m_traces.clear();
+        m_first_traces.clear();
+        m_best_traces.clear();
+        m_first_labeling.clear();
+        m_best_labeling.clear();
+        m_generators.clear();
+        m_num_best_updates = 0;
+        m_num_tree_nodes = 0;
+        m_num_leaves = 0;
+
+        // Initial partition: cells of node labels (ordered by value), all of
+        // them splitters.
+        PartitionRefinement::OrderedPartition partition(m_csr.get_node_labels());
+        vector<uint> splitters;
+        for( uint begin = 0; begin < n; begin = partition.cell_end[begin] )
+            splitters.push_back(begin);
+        m_traces.emplace_back();
+        refine(partition, splitters, m_traces.back(), nullptr, nullptr);
+        search(partition, 0, true, 0);
+
+        m_orbits.resize(n);
+        iota(m_orbits.begin(), m_orbits.end(), 0);
+        for( const Nodes &generator : m_generators )
+            merge_orbits(m_orbits, generator);
+        for( Node v = 0; v < n; ++v )
+            m_orbits[v] = find(m_orbits, v);
+    }
+
+    bool CanonicalLabeling::refine(PartitionRefinement::OrderedPartition &partition, const vector<uint> &splitters, vector<size_t> &trace,
+                                   const vector<size_t> *bound, const vector<size_t> *first) {
+        ++m_num_tree_nodes;
+        trace.clear();
+        int cmp_bound = 0;
+        bool is_first = first != nullptr;
+        return m_refinement.refine(partition, splitters, [&](size_t h) {
+            size_t pass = trace.size();
+            trace.push_back(h);
+            if( (bound != nullptr) && (cmp_bound == 0) )
+                cmp_bound = pass >= bound->size() ? 1 : (h < (*bound)[pass] ? -1 : (h > (*bound)[pass] ? 1 : 0));
+            if( is_first && ((pass >= first->size()) || (h != (*first)[pass])) )
+                is_first = false;
+            return (cmp_bound <= 0) || is_first;
+        });
+    }
+
+    size_t CanonicalLabeling::search(const PartitionRefinement::OrderedPartition &partition, size_t depth, bool is_first, int cmp_best) {
+        size_t n = m_csr.get_num_nodes();
+        if( partition.discrete() ) return leaf(partition, depth, is_first, cmp_best);
+
+        // Target cell: first smallest non-singleton cell.
+        uint target = n;
+        for( uint begin = 0; begin < n; begin = partition.cell_end[begin] ) {
+            if( (partition.size(begin) > 1) && ((target == n) || (partition.size(begin) < partition.size(target))) )
+                target = begin;
+        }
+
+        Nodes cell(partition.elements.begin() + target, partition.elements.begin() + partition.cell_end[target]), explored;
+        sort(cell.begin(), cell.end());
+        PartitionRefinement::OrderedPartition child;
+        vector<uint> splitters(1);
+        Nodes parent(n);
+        size_t num_generators = 0;
+        const vector<size_t> no_trace;
+        for( Node w : cell ) {
+            // Skip "w" if mapped to an explored child by automorphisms that
+            // fix the path (orbits are updated when generators are found).
+            if( !explored.empty() ) {
+                if( num_generators < m_generators.size() ) {
+                    if( num_generators == 0 ) iota(parent.begin(), parent.end(), 0);
+                    for( ; num_generators < m_generators.size(); ++num_generators ) {
+                        const Nodes &generator = m_generators[num_generators];
+                        if( all_of(m_path.begin(), m_path.end(), [&](Node v) { return generator[v] == v; }) )
+                            merge_orbits(parent, generator);
+                    }
+                }
+                if( (num_generators > 0) && any_of(explored.begin(), explored.end(), [&](Node v) { return find(parent, v) == find(parent, w); }) )
+                    continue;
+            }
+            explored.push_back(w);
+
+            // Individualize "w": it comes first in its cell, and is the only
+            // splitter of the refinement. Its subtree is pruned if its trace
+            // is larger than the one of the best path and differs from the
+            // one of the first path.
+            child = partition;
+            splitters[0] = child.individualize(w);
+            bool has_first = m_num_leaves > 0;
+            const vector<size_t> *first = is_first && has_first && (depth + 1 < m_first_traces.size()) ? &m_first_traces[depth + 1] : nullptr;
+            const vector<size_t> *bound = (cmp_best == 0) && has_first ? (depth + 1 < m_best_traces.size() ? &m_best_traces[depth + 1] : &no_trace) : nullptr;
+            m_traces.emplace_back();
+            if( refine(child, splitters, m_traces.back(), bound, first) ) {
+                const vector<size_t> &trace = m_traces.back();
+                bool child_is_first = is_first && (!has_first || (first != nullptr && trace == *first));
+                int child_cmp_best = bound == nullptr ? cmp_best : (trace < *bound ? -1 : (*bound < trace ? 1 : 0));
+                if( child_is_first || (child_cmp_best <= 0) ) {
+                    size_t num_best_updates = m_num_best_updates;
+                    m_path.push_back(w);
+                    size_t level = search(child, depth + 1, child_is_first, child_cmp_best);
+                    m_path.pop_back();
+                    if( level < depth ) {
+                        m_traces.pop_back();
+                        return level;
+                    }
+                    // A new best leaf below makes this node part of the best path.
+                    if( m_num_best_updates != num_best_updates ) cmp_best = 0;
+                }
+            }
+            m_traces.pop_back();
+        }
+        return depth;
+    }
+
+    size_t CanonicalLabeling::leaf(const PartitionRefinement::OrderedPartition &partition, size_t depth, bool is_first, int cmp_best) {
+        ++m_num_leaves;
+        const Nodes &labeling = partition.position;
+        if( m_num_leaves == 1 ) {
+            m_first_path = m_path;
+            m_first_traces = m_traces;
+            m_first_labeling = labeling;
+            get_certificate(labeling, m_first_certificate);
+            m_best_traces = m_traces;
+            m_best_labeling = labeling;
+            m_best_certificate = m_first_certificate;
+            ++m_num_best_updates;
+            return depth;
+        }
+
+        get_certificate(labeling, m_certificate);
+        if( is_first && (m_certificate == m_first_certificate) ) {
+            // Jump back to where paths diverge: the subtree there is the
+            // image of the one of the first path.
+            add_automorphism(m_first_labeling, labeling);
+            size_t level = 0;
+            while( (level < m_path.size()) && (m_path[level] == m_first_path[level]) ) ++level;
+            return level;
+        } else if( (cmp_best < 0) || ((cmp_best == 0) && (m_certificate < m_best_certificate)) ) {
+            m_best_traces = m_traces;
+            m_best_labeling = labeling;
+            m_best_certificate.swap(m_certificate);
+            ++m_num_best_updates;
+        } else if( (cmp_best == 0) && (m_certificate == m_best_certificate) ) {
+            add_automorphism(m_best_labeling, labeling);
+        }
+        return depth;
+    }
+
+    void CanonicalLabeling::get_certificate(const Nodes &labeling, Labels &certificate) const {
+        size_t n = m_csr.get_num_nodes();
+        Labels node_labels(n);
+        vector<tuple<Node, Node, Label> > arcs;
+        arcs.reserve(m_csr.get_num_edges());
+        for( Node v = 0; v < n; ++v ) {
+            node_labels[labeling[v]] = m_csr.get_node_labels()[v];
+            for( const GraphLibrary::CSRGraph::Arc *a = m_csr.outbound_begin(v); a != m_csr.outbound_end(v); ++a )
+                arcs.emplace_back(labeling[v], labeling[a->node], a->label);
+        }
+        sort(arcs.begin(), arcs.end());
+
+        certificate.clear();
+        certificate.push_back(n);
+        certificate.insert(certificate.end(), node_labels.begin(), node_labels.end());
+        for( const tuple<Node, Node, Label> &arc : arcs ) {
+            certificate.push_back(get<0>(arc));
+            certificate.push_back(get<1>(arc));
+            certificate.push_back(get<2>(arc));
+        }
+    }
+
+    void CanonicalLabeling::add_automorphism(const Nodes &from, const Nodes &to) {
+        size_t n = m_csr.get_num_nodes();
+        Nodes inverse(n), generator(n);
+        for( Node v = 0; v < n; ++v )
+            inverse[to[v]] = v;
+        bool identity = true;
+        for( Node v = 0; v < n; ++v ) {
+            generator[v] = inverse[from[v]];
+            identity = identity && (generator[v] == v);
+        }
+        if( !identity ) m_generators.push_back(std::move(generator));
+    }
+}
@@ -0,0 +1,133 @@
+/**********************************************************************
+ * Canonical labeling and automorphism group by individualization and
+ * refinement.
+ *
+ * The search tree is built over ordered partitions of the nodes. Each
+ * partition is refined until equitable by the splitter-based engine of
+ * PartitionRefinement, which splits cells in place and orders their parts
+ * by the number of neighbors in the splitter, so that the ordered
+ * partition does not depend on the numbering of the nodes. While the
+ * partition is not discrete, the nodes of the first smallest non-singleton
+ * cell are individualized one at a time: the node is split from its cell,
+ * and the child partition is refined with its singleton cell as the only
+ * splitter, which only touches the cells around it. Each leaf (discrete
+ * partition) gives a labeling of the nodes: their positions. Each
+ * refinement also records a trace: a hash of the splits of each splitter
+ * pass. The canonical labeling is the one of the leaf with the smallest
+ * traces along its path and, among those, the smallest relabeled graph
+ * (node labels and labeled arcs). A refinement is cut short as soon as
+ * its trace is larger than the one of the best path, unless it may still
+ * match the first path.
+ *
+ * Two leaves with the same traces and relabeled graph give an
+ * automorphism. Found automorphisms prune the search: a child is skipped
+ * if an automorphism that fixes the individualized nodes maps it to a
+ * child already explored, and an automorphism found against the first
+ * leaf jumps back to the node where the two paths diverge (McKay.
+ * Practical Graph Isomorphism. Congressus Numerantium 30, 1981). The
+ * found automorphisms generate the automorphism group, whose orbits are
+ * also computed.
+ *********************************************************************/
+
+#ifndef CANONICAL_LABELING_H
+#define CANONICAL_LABELING_H
+
+#include <vector>
+#include "CSRGraph.h"
+#include "PartitionRefinement.h"
+#include "SignatureTable.h"
+
+namespace ColorRefinement {
+    class CanonicalLabeling {
+      public:
+        // Ctors/dtor.
+        explicit CanonicalLabeling(const GraphLibrary::CSRGraph &csr) : m_csr(csr), m_refinement(csr), m_num_best_updates(0), m_num_tree_nodes(0), m_num_leaves(0) { }
+        ~CanonicalLabeling() { }
+
+        // Search for canonical labeling and automorphisms.
+        void compute();
+
+        // Canonical label in { 0, ..., #nodes - 1 } of each node: isomorphic
+        // graphs get equal relabeled graphs.
+        const Nodes& get_labeling() const {
+            return m_best_labeling;
+        }
+
+        // Hash of relabeled graph (equal for isomorphic graphs).
+        size_t get_hash() const {
+            return SignatureTable::hash(m_best_certificate.data(), m_best_certificate.size());
+        }
+
+        // Generators of automorphism group, as images of the nodes.
+        const std::vector<Nodes>& get_generators() const {
+            return m_generators;
+        }
+
+        // Orbit of each node under the automorphism group, given by its
+        // smallest node.
+        const Nodes& get_orbits() const {
+            return m_orbits;
+        }
+
+        // Number of nodes of the search tree (refinements) and of leaves.
+        size_t get_num_tree_nodes() const {
+            return m_num_tree_nodes;
+        }
+        size_t get_num_leaves() const {
+            return m_num_leaves;
+        }
+
+      private:
+        const GraphLibrary::CSRGraph &m_csr;
+        const PartitionRefinement m_refinement;
+
+        // Individualized nodes and traces of current path, and of first and
+        // best leaves.
+        Nodes m_path;
+        Nodes m_first_path;
+        std::vector<std::vector<size_t> > m_traces;
+        std::vector<std::vector<size_t> > m_first_traces;
+        std::vector<std::vector<size_t> > m_best_traces;
+        size_t m_num_best_updates;
+
+        // Labelings and relabeled graphs of first and best leaves.
+        Nodes m_first_labeling;
+        Labels m_first_certificate;
+        Nodes m_best_labeling;
+        Labels m_best_certificate;
+
+        std::vector<Nodes> m_generators;
+        Nodes m_orbits;
+        size_t m_num_tree_nodes;
+        size_t m_num_leaves;
+
+        // Scratch.
+        Labels m_certificate;
+
+        // Refine partition until equitable from the given splitters,
+        // recording the trace. Returns false if the trace becomes larger than
+        // "bound" while differing from "first" (if given).
+        bool refine(PartitionRefinement::OrderedPartition &partition, const std::vector<uint> &splitters, std::vector<size_t> &trace,
+                    const std::vector<size_t> *bound, const std::vector<size_t> *first);
+
+        // Explore subtree of "partition" at given depth, whose traces from
+        // the root are equal to those of the first path (if "is_first") and
+        // compare to those of the best path as "cmp_best" (-1, 0 or 1).
+        // Returns the depth to jump back to (depth itself to go on with
+        // siblings).
+        size_t search(const PartitionRefinement::OrderedPartition &partition, size_t depth, bool is_first, int cmp_best);
+
+        // Handle leaf with given discrete partition.
+        size_t leaf(const PartitionRefinement::OrderedPartition &partition, size_t depth, bool is_first, int cmp_best);
+
+        // Relabeled graph: node labels and sorted arcs in canonical order.
+        void get_certificate(const Nodes &labeling, Labels &certificate) const;
+
+        // Add automorphism mapping the node with label i in "from" to the
+        // node with label i in "to".
+        void add_automorphism(const Nodes &from, const Nodes &to);
+    };
+}
+
+#endif // CANONICAL_LABELING_H
+
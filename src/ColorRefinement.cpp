@@ -18,22 +18,33 @@
  *********************************************************************/
 
 #include <algorithm>
+#include <chrono>
 #include <queue>
+#include <thread>
+#include <sys/resource.h>
 #include "ColorRefinement.h"
 
 using namespace std;
 
 namespace ColorRefinement {
-    int ColorRefinement::compute_stable_coloring(unordered_set<Label> &node_colors,
-                                                 unordered_multimap<Label, Node> &colors_to_nodes,
-                                                 unordered_map<Node, Label> &node_to_color,
+    int ColorRefinement::compute_stable_coloring(const GraphLibrary::CSRGraph &csr,
+                                                 Coloring &result,
                                                  const Labels &node_labels,
-                                                 uint num_edge_labels,
-                                                 const Labels &edge_labels,
-                                                 bool normalize_colors) const {
-        // Assumption: edge labels are in { 0, ..., num_edge_labels - 1 }.
-        for( Label label : edge_labels )
-            assert(label < num_edge_labels);
+                                                 const Options &options) const {
+        if( csr.undirected() )
+            return refine<true>(csr, result, node_labels, options);
+        else
+            return refine<false>(csr, result, node_labels, options);
+    }
+
+    template<bool Undirected>
+    int ColorRefinement::refine(const GraphLibrary::CSRGraph &csr,
+                                Coloring &result,
+                                const Labels &node_labels,
+                                const Options &options) const {
+        bool normalize_colors = options.normalize_colors;
+        bool exact_colors = options.exact_colors;
+        uint num_threads = options.num_threads;
 
         // Need node labels { 1, ... } since color 0 is marker
         bool add_one_to_node_labels = false;
@@ -44,7 +55,7 @@ namespace ColorRefinement {
             }
         }
 
-        Node num_nodes = m_graph.get_num_nodes();
+        Node num_nodes = csr.get_num_nodes();
         assert(node_labels.size() == num_nodes);
         Labels coloring(num_nodes, 0);
         Labels new_coloring(node_labels);
@@ -56,79 +67,354 @@ namespace ColorRefinement {
                 ++new_coloring[i];
         }
 
+        // Chunks of nodes for threads, balanced by number of arcs.
+        num_threads = max(1U, min<uint>(num_threads, num_nodes));
+        Nodes chunks(1, 0);
+        size_t total_weight = num_nodes + 2 * csr.get_num_edges();
+        size_t weight = 0;
+        for( Node v = 0; v < num_nodes; ++v ) {
+            weight += 1 + csr.get_out_degree(v) + csr.get_in_degree(v);
+            if( weight * num_threads >= total_weight * chunks.size() )
+                chunks.push_back(v + 1);
+        }
+        while( chunks.size() <= num_threads )
+            chunks.push_back(num_nodes);
+
+        auto start_time = chrono::steady_clock::now();
+        bool stable = false;
         int num_iterations = 0;
         unordered_set<Label> new_colors;
+        SignatureTable signatures;
+        vector<SignatureTable> local_signatures(num_threads > 1 ? num_threads : 0);
+        vector<Labels> scratch(local_signatures.size());
+        Labels signature;
+        unordered_map<Label, Label> normalized_colors;
         while( num_new_colors != num_old_colors ) {
-            // Update coloring.
-            coloring = new_coloring;
+            auto start = chrono::steady_clock::now();
+            if( (options.max_rounds > 0) && (num_iterations >= int(options.max_rounds)) ) break;
+            if( (options.time_budget > 0) && (num_iterations > 0) && (chrono::duration<double>(start - start_time).count() >= options.time_budget) ) break;
+
+            // Update coloring (all entries of new_coloring are rewritten below).
+            coloring.swap(new_coloring);
             num_old_colors = num_new_colors;
             new_colors.clear();
             ++num_iterations;
 
-            // Iterate over all nodes.
-            for( Node v = 0; v < num_nodes; ++v ) {
-                // It is assumed that edge colors are in { 0, ..., num_edge_labels-1 }.
-                const Edges &outbound_edges = m_graph.get_outbound_edges(v);
-                const Edges &inbound_edges = m_graph.get_inbound_edges(v);
-                vector<Labels> colors(2 * num_edge_labels);
-
-                // Process edges by color while getting colors of neighbors.
-                for( Edge e : outbound_edges ) {
-                    assert(m_graph.get_src(e) == v);
-                    Node n = m_graph.get_dst(e);
-                    Label edge_color = edge_labels.at(e);
-                    colors[edge_color].push_back(coloring[n]);
+            // Exact colors are the ids of the interned node signatures.
+            if( exact_colors && (num_threads > 1) ) {
+                num_new_colors = compute_exact_round<Undirected>(csr, coloring, new_coloring, chunks, local_signatures, scratch, signatures);
+            } else if( exact_colors ) {
+                signatures.clear();
+                for( Node v = 0; v < num_nodes; ++v ) {
+                    get_signature<Undirected>(csr, coloring.data(), v, signature);
+                    new_coloring[v] = signatures.intern(signature.data(), signature.size());
                 }
-                for( Edge e : inbound_edges ) {
-                    assert(m_graph.get_dst(e) == v);
-                    Node n = m_graph.get_src(e);
-                    Label edge_color = edge_labels.at(e);
-                    colors[num_edge_labels + edge_color].push_back(coloring[n]);
+                num_new_colors = signatures.size();
+            } else {
+                // Iterate over all nodes.
+                for( Node v = 0; v < num_nodes; ++v ) {
+                    Label new_color = options.sparse_labels ? get_sparse_paired_color<Undirected>(csr, coloring, v, signature) : get_paired_color<Undirected>(csr, coloring, v, signature);
+                    new_colors.insert(new_color);
+                    new_coloring[v] = new_color;
                 }
+                num_new_colors = new_colors.size();
 
-                // Insert marker (color 0) in each group and sort them.
-                for( uint i = 0; i < num_edge_labels; ++i ) {
-                    colors[i].push_back(0);
-                    colors[num_edge_labels + i].push_back(0);
-                    sort(colors[i].begin(), colors[i].end());
-                    sort(colors[num_edge_labels + i].begin(), colors[num_edge_labels + i].end());
+                if( normalize_colors ) {
+                    normalized_colors.clear();
+                    for( Node v = 0; v < num_nodes; ++v ) {
+                        Label color = new_coloring[v];
+                        if( normalized_colors.find(color) == normalized_colors.end() )
+                            normalized_colors[color] = 1 + normalized_colors.size();
+                        new_coloring[v] = normalized_colors[color];
+                    }
+                    assert(normalized_colors.size() == num_new_colors);
                 }
+            }
 
-                // Compute new label using composition to bijectively map two integers to on integer.
-                // Initial color is color of vertex v as this must be taken into account as well.
-                Label new_color = coloring[v];
-                for( uint i = 0; i < num_edge_labels; ++i ) {
-                    for( Label c : colors[i] )
-                        new_color = pairing(new_color, c);
-                    for( Label c : colors[num_edge_labels + i] )
-                        new_color = pairing(new_color, c);
-                }
-                new_colors.insert(new_color);
-                new_coloring[v] = new_color;
+            if( options.round_stats != nullptr ) {
+                RoundStats stats;
+                stats.elapsed_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                get_round_stats(coloring.data(), new_coloring.data(), num_nodes, stats);
+                stats.num_arcs_scanned = (Undirected ? 1 : 2) * csr.get_num_edges();
+                options.round_stats->push_back(stats);
             }
-            num_new_colors = new_colors.size();
 
-            if( normalize_colors ) {
-                unordered_map<Label, Label> normalized_colors;
-                unordered_set<Label> new_new_colors;
-                for( Node v = 0; v < num_nodes; ++v ) {
-                    Label color = new_coloring[v];
-                    if( normalized_colors.find(color) == normalized_colors.end() ) {
-                        normalized_colors[color] = 1 + normalized_colors.size();
-                        new_new_colors.insert(normalized_colors[color]);
+            // Colors of rounds after the first are numbered in order of first
+            // occurrence, so a last round would give the same colors. Paired
+            // colors of a last round differ from those of this one, so
+            // that round is always run without dense colors.
+            bool dense_colors = exact_colors || normalize_colors;
+            bool round_left = (options.max_rounds == 0) || (num_iterations < int(options.max_rounds));
+            if( options.detect_stability && dense_colors && (num_iterations > 1) && round_left && (num_new_colors != num_old_colors) ) {
+                start = chrono::steady_clock::now();
+                size_t num_arcs_scanned = 0;
+                if( is_stable<Undirected>(csr, coloring, new_coloring, num_new_colors, num_arcs_scanned) ) {
+                    ++num_iterations;
+                    stable = true;
+                    if( options.round_stats != nullptr ) {
+                        RoundStats stats;
+                        stats.elapsed_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                        get_round_stats(new_coloring.data(), new_coloring.data(), num_nodes, stats);
+                        stats.num_arcs_scanned = num_arcs_scanned;
+                        options.round_stats->push_back(stats);
                     }
-                    new_coloring[v] = normalized_colors[color];
+                    break;
+                }
+            }
+        }
+        if( options.stable != nullptr ) *options.stable = stable || (num_new_colors == num_old_colors);
+
+        result.assign(std::move(new_coloring));
+        return num_iterations;
+    }
+
+    template<bool Undirected>
+    Label ColorRefinement::compute_exact_round(const GraphLibrary::CSRGraph &csr,
+                                               const Labels &coloring,
+                                               Labels &new_coloring,
+                                               const Nodes &chunks,
+                                               vector<SignatureTable> &local_signatures,
+                                               vector<Labels> &scratch,
+                                               SignatureTable &signatures) const {
+        // Intern signatures of each chunk in local table, storing local ids.
+        vector<thread> threads;
+        for( size_t t = 0; t < local_signatures.size(); ++t ) {
+            threads.emplace_back([&, t]() {
+                Labels &signature = scratch[t];
+                SignatureTable &table = local_signatures[t];
+                table.clear();
+                for( Node v = chunks[t]; v < chunks[t + 1]; ++v ) {
+                    get_signature<Undirected>(csr, coloring.data(), v, signature);
+                    new_coloring[v] = table.intern(signature.data(), signature.size());
                 }
-                assert(normalized_colors.size() == num_new_colors);
-                new_colors = new_new_colors;
+            });
+        }
+        for( thread &t : threads )
+            t.join();
+
+        // Merge local tables in chunk order.
+        signatures.clear();
+        vector<Labels> local_to_global(local_signatures.size());
+        for( size_t t = 0; t < local_signatures.size(); ++t ) {
+            const SignatureTable &table = local_signatures[t];
+            local_to_global[t].resize(1 + table.size());
+            for( Label id = 1; id <= table.size(); ++id )
+                local_to_global[t][id] = signatures.intern(table.get_signature(id), table.get_length(id), table.get_hash(id));
+        }
+
+        // Translate local ids into global ids.
+        threads.clear();
+        for( size_t t = 0; t < local_signatures.size(); ++t ) {
+            threads.emplace_back([&, t]() {
+                for( Node v = chunks[t]; v < chunks[t + 1]; ++v )
+                    new_coloring[v] = local_to_global[t][new_coloring[v]];
+            });
+        }
+        for( thread &t : threads )
+            t.join();
+        return signatures.size();
+    }
+
+    template<bool Undirected>
+    Label ColorRefinement::get_paired_color(const GraphLibrary::CSRGraph &csr, const Labels &coloring, Node v, Labels &scratch) const {
+        // Compute new label using composition to bijectively map two integers to on integer.
+        // Initial color is color of vertex v as this must be taken into account as well.
+        // For each label, the outbound group and then the inbound group are folded: first
+        // the marker (color 0), and then the sorted colors of the neighbors in the group.
+        const GraphLibrary::CSRGraph::Arc *out = csr.outbound_begin(v), *out_end = csr.outbound_end(v);
+        const GraphLibrary::CSRGraph::Arc *in = csr.inbound_begin(v), *in_end = csr.inbound_end(v);
+        Label new_color = coloring[v];
+        for( uint i = 0; i < csr.get_num_edge_labels(); ++i ) {
+            new_color = pairing(new_color, 0);
+            scratch.clear();
+            if( (out != out_end) && (out->label == i) ) {
+                for( ; (out != out_end) && (out->label == i); ++out )
+                    scratch.push_back(coloring[out->node]);
+                sort_colors(scratch.data(), scratch.data() + scratch.size());
+                for( Label c : scratch )
+                    new_color = pairing(new_color, c);
+            }
+            new_color = pairing(new_color, 0);
+            if( Undirected ) {
+                // Inbound group is the outbound one.
+                for( Label c : scratch )
+                    new_color = pairing(new_color, c);
+            } else if( (in != in_end) && (in->label == i) ) {
+                scratch.clear();
+                for( ; (in != in_end) && (in->label == i); ++in )
+                    scratch.push_back(coloring[in->node]);
+                sort_colors(scratch.data(), scratch.data() + scratch.size());
+                for( Label c : scratch )
+                    new_color = pairing(new_color, c);
+            }
+        }
+        return new_color;
+    }
+
+    template<bool Undirected>
+    Label ColorRefinement::get_sparse_paired_color(const GraphLibrary::CSRGraph &csr, const Labels &coloring, Node v, Labels &scratch) const {
+        uint num_edge_labels = csr.get_num_edge_labels();
+        Label new_color = coloring[v];
+        if( Undirected ) {
+            // Sort the groups once, and fold them as outbound and then as
+            // inbound groups.
+            const GraphLibrary::CSRGraph::Arc *begin = csr.outbound_begin(v), *end = csr.outbound_end(v);
+            scratch.clear();
+            for( const GraphLibrary::CSRGraph::Arc *a = begin; a != end; ) {
+                uint label = a->label;
+                size_t pos = scratch.size();
+                for( ; (a != end) && (a->label == label); ++a )
+                    scratch.push_back(coloring[a->node]);
+                sort_colors(scratch.data() + pos, scratch.data() + scratch.size());
+            }
+            for( int direction = 0; direction < 2; ++direction ) {
+                const Label *c = scratch.data();
+                for( const GraphLibrary::CSRGraph::Arc *a = begin; a != end; ) {
+                    uint label = a->label;
+                    new_color = pairing(new_color, 0);
+                    new_color = pairing(new_color, 1 + direction * num_edge_labels + label);
+                    for( ; (a != end) && (a->label == label); ++a )
+                        new_color = pairing(new_color, *c++);
+                }
+            }
+            return new_color;
+        }
+        for( int direction = 0; direction < 2; ++direction ) {
+            const GraphLibrary::CSRGraph::Arc *begin = direction == 0 ? csr.outbound_begin(v) : csr.inbound_begin(v);
+            const GraphLibrary::CSRGraph::Arc *end = direction == 0 ? csr.outbound_end(v) : csr.inbound_end(v);
+            while( begin != end ) {
+                uint label = begin->label;
+                scratch.clear();
+                for( ; (begin != end) && (begin->label == label); ++begin )
+                    scratch.push_back(coloring[begin->node]);
+                sort_colors(scratch.data(), scratch.data() + scratch.size());
+                new_color = pairing(new_color, 0);
+                new_color = pairing(new_color, 1 + direction * num_edge_labels + label);
+                for( Label c : scratch )
+                    new_color = pairing(new_color, c);
+            }
+        }
+        return new_color;
+    }
+
+    template<bool Undirected>
+    bool ColorRefinement::is_stable(const GraphLibrary::CSRGraph &csr, const Labels &old_coloring, const Labels &coloring, Label num_colors, size_t &num_arcs_scanned) const {
+        // A discrete coloring is stable.
+        Node num_nodes = csr.get_num_nodes();
+        if( num_colors == num_nodes ) return true;
+
+        // Classes of the round and their parents (classes are nested, so
+        // there are at most as many parents as classes).
+        vector<size_t> class_size(1 + num_colors, 0);
+        Labels parent(1 + num_colors, 0);
+        vector<uint> num_children(1 + num_colors, 0);
+        for( Node v = 0; v < num_nodes; ++v ) {
+            Label c = coloring[v];
+            if( class_size[c]++ == 0 ) {
+                parent[c] = old_coloring[v];
+                ++num_children[parent[c]];
             }
         }
 
-        node_colors = new_colors;
-        for( Node i = 0; i < num_nodes; ++i ) {
-            colors_to_nodes.insert({{new_coloring[i], i}});
-            node_to_color.insert({{i, new_coloring[i]}});
+        // Budget: a quarter of the work of a round.
+        size_t budget = (num_nodes + (Undirected ? 1 : 2) * csr.get_num_edges()) / 4;
+        size_t work = 0;
+        vector<bool> split(1 + num_colors, false);
+        for( Label c = 1; c <= num_colors; ++c ) {
+            split[c] = num_children[parent[c]] > 1;
+            if( split[c] ) work += class_size[c];
+        }
+        if( work > budget ) return false;
+
+        // Classes with a node adjacent to a split class.
+        vector<bool> touched(1 + num_colors, false);
+        for( Node v = 0; v < num_nodes; ++v ) {
+            if( !split[coloring[v]] ) continue;
+            size_t degree = csr.get_out_degree(v) + (Undirected ? 0 : csr.get_in_degree(v));
+            num_arcs_scanned += degree;
+            work += degree;
+            if( work > budget ) return false;
+            for( const GraphLibrary::CSRGraph::Arc *a = csr.outbound_begin(v); a != csr.outbound_end(v); ++a )
+                touched[coloring[a->node]] = true;
+            if( Undirected ) continue;
+            for( const GraphLibrary::CSRGraph::Arc *a = csr.inbound_begin(v); a != csr.inbound_end(v); ++a )
+                touched[coloring[a->node]] = true;
+        }
+        for( Label c = 1; c <= num_colors; ++c ) {
+            if( touched[c] ) work += class_size[c];
+        }
+        if( work > budget ) return false;
+
+        // Touched classes are stable if their nodes have equal signatures.
+        unordered_map<Label, Labels> first_signature;
+        Labels signature;
+        for( Node v = 0; v < num_nodes; ++v ) {
+            if( !touched[coloring[v]] ) continue;
+            size_t degree = csr.get_out_degree(v) + (Undirected ? 0 : csr.get_in_degree(v));
+            num_arcs_scanned += degree;
+            work += degree;
+            if( work > budget ) return false;
+            get_signature<Undirected>(csr, coloring.data(), v, signature);
+            pair<unordered_map<Label, Labels>::iterator, bool> p = first_signature.emplace(coloring[v], signature);
+            if( !p.second && (p.first->second != signature) ) return false;
         }
+        return true;
+    }
+
+    void get_round_stats(const Label *coloring, const Label *new_coloring, Node num_nodes, RoundStats &stats) {
+        // Colors need not be dense (pairing()), so classes are counted in
+        // maps. A new class is contained in the old class of its nodes since
+        // signatures start with the old color.
+        unordered_map<Label, size_t> class_size;
+        unordered_map<Label, Label> parent;
+        for( Node v = 0; v < num_nodes; ++v ) {
+            if( ++class_size[new_coloring[v]] == 1 )
+                parent.emplace(new_coloring[v], coloring[v]);
+        }
+        unordered_map<Label, size_t> largest_subclass;
+        stats.largest_class = 0;
+        for( const pair<const Label, size_t> &c : class_size ) {
+            size_t &largest = largest_subclass[parent[c.first]];
+            largest = max(largest, c.second);
+            stats.largest_class = max(stats.largest_class, c.second);
+        }
+        stats.num_colors = class_size.size();
+        stats.num_changed = num_nodes;
+        for( const pair<const Label, size_t> &c : largest_subclass )
+            stats.num_changed -= c.second;
+        stats.num_arcs_scanned = 0;
+        stats.peak_memory = get_peak_memory();
+    }
+
+    size_t get_peak_memory() {
+        struct rusage usage;
+        if( getrusage(RUSAGE_SELF, &usage) != 0 ) return 0;
+#ifdef __APPLE__
+        // In bytes on macOS.
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+
+    int ColorRefinement::compute_stable_coloring(unordered_set<Label> &node_colors,
+                                                 unordered_multimap<Label, Node> &colors_to_nodes,
+                                                 unordered_map<Node, Label> &node_to_color,
+                                                 const Labels &node_labels,
+                                                 uint num_edge_labels,
+                                                 const Labels &edge_labels,
+                                                 bool normalize_colors) const {
+        // Assumption: edge labels are in { 0, ..., num_edge_labels - 1 }.
+        for( Label label : edge_labels )
+            assert(label < num_edge_labels);
+
+        assert(m_graph != nullptr);
+        GraphLibrary::CSRGraph csr(*m_graph, edge_labels, num_edge_labels);
+        Options options;
+        options.normalize_colors = normalize_colors;
+        Coloring coloring;
+        int num_iterations = compute_stable_coloring(csr, coloring, node_labels, options);
+        coloring.get_maps(node_colors, colors_to_nodes, node_to_color);
         return num_iterations;
     }
 
@@ -136,13 +422,35 @@ namespace ColorRefinement {
                                                  unordered_multimap<Label, Node> &colors_to_nodes,
                                                  unordered_map<Node, Label> &node_to_color,
                                                  bool normalize_colors) const {
+        if( m_csr != nullptr ) {
+            Options options;
+            options.normalize_colors = normalize_colors;
+            return compute_stable_coloring(node_colors, colors_to_nodes, node_to_color, Labels(m_csr->get_num_nodes(), 1), options);
+        }
         return compute_stable_coloring(node_colors,
                                        colors_to_nodes,
                                        node_to_color,
-                                       Labels(m_graph.get_num_nodes(), 1),
+                                       Labels(m_graph->get_num_nodes(), 1),
                                        1,
-                                       Labels(m_graph.get_num_edges(), 0),
+                                       Labels(m_graph->get_num_edges(), 0),
                                        normalize_colors);
     }
-}
 
+    int ColorRefinement::compute_stable_coloring(unordered_set<Label> &node_colors,
+                                                 unordered_multimap<Label, Node> &colors_to_nodes,
+                                                 unordered_map<Node, Label> &node_to_color,
+                                                 const Labels &node_labels,
+                                                 const Options &options) const {
+        Coloring coloring;
+        int num_iterations = compute_stable_coloring(coloring, node_labels, options);
+        coloring.get_maps(node_colors, colors_to_nodes, node_to_color);
+        return num_iterations;
+    }
+
+    int ColorRefinement::compute_stable_coloring(Coloring &coloring,
+                                                 const Labels &node_labels,
+                                                 const Options &options) const {
+        assert(m_csr != nullptr);
+        return compute_stable_coloring(*m_csr, coloring, node_labels, options);
+    }
+}
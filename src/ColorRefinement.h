@@ -22,18 +22,88 @@
 
 #include <iostream>
 #include <unordered_map>
+#include "CSRGraph.h"
+#include "Coloring.h"
 #include "Graph.h"
+#include "SignatureTable.h"
 
 using Labeling = std::unordered_multimap<Label, Node>;
 
 namespace ColorRefinement {
+    // Statistics of a round of the refinement loop.
+    struct RoundStats {
+        // Wall time in seconds.
+        double elapsed_time;
+        // Number of classes after the round.
+        size_t num_colors;
+        // Number of nodes that left their class: for each class of the
+        // previous round, the nodes outside its largest subclass. Refinement
+        // has stalled when it is 0.
+        size_t num_changed;
+        // Size of largest class after the round.
+        size_t largest_class;
+        // Number of arcs scanned (each arc is scanned at both endpoints).
+        size_t num_arcs_scanned;
+        // Peak resident memory of the process in KB.
+        size_t peak_memory;
+    };
+
+    // Peak resident memory of the process in KB.
+    size_t get_peak_memory();
+
+    // Statistics of a round that maps "coloring" into "new_coloring" (colors
+    // of "num_nodes" nodes), but for the time and the arcs scanned.
+    void get_round_stats(const Label *coloring, const Label *new_coloring, Node num_nodes, RoundStats &stats);
+
+    // Options of the refinement loop over a CSR view.
+    struct Options {
+        // Normalize node colors after each round to reduce overflows.
+        bool normalize_colors;
+        // Intern node signatures instead of folding them with pairing().
+        bool exact_colors;
+        // Fold only the (direction, label) groups that a node has.
+        bool sparse_labels;
+        // Number of threads used to compute exact colors.
+        uint num_threads;
+        // If not null, the statistics of each round are appended.
+        std::vector<RoundStats> *round_stats;
+        // Maximum number of rounds (0 for no limit).
+        uint max_rounds;
+        // Wall time in seconds after which no new round is started (0 for no
+        // limit). At least one round is done.
+        double time_budget;
+        // With exact or normalized colors, check after each round whether a
+        // class can still split, by looking only at the classes with a node
+        // adjacent to a class that just split, and stop if none does. The last
+        // round, which would give the same coloring, is then skipped (it is
+        // still counted). Paired colors (the default) always run that round.
+        bool detect_stability;
+        // If not null, set to whether the coloring is stable (false if a limit
+        // on rounds or time was hit first).
+        bool *stable;
+
+        Options()
+          : normalize_colors(false),
+            exact_colors(false),
+            sparse_labels(false),
+            num_threads(1),
+            round_stats(nullptr),
+            max_rounds(0),
+            time_budget(0),
+            detect_stability(true),
+            stable(nullptr) {
+        }
+    };
+
     class ColorRefinement {
       public:
         // Ctors/dtor.
-        explicit ColorRefinement(const GraphLibrary::Graph &graph) : m_graph(graph) { }
+        explicit ColorRefinement(const GraphLibrary::Graph &graph) : m_graph(&graph), m_csr(nullptr) { }
+        explicit ColorRefinement(const GraphLibrary::CSRGraph &csr) : m_graph(nullptr), m_csr(&csr) { }
         ~ColorRefinement() { }
 
-        // Compute stable coloring of graph "m_graph".
+        // Compute stable coloring of graph "m_graph". A CSR view of the graph
+        // with the given edge labels is built for the computation.
         int compute_stable_coloring(std::unordered_set<Label> &node_colors,
                                     std::unordered_multimap<Label, Node> &colors_to_nodes,
                                     std::unordered_map<Node, Label> &node_to_color,
@@ -46,9 +116,76 @@ namespace ColorRefinement {
                                     std::unordered_map<Node, Label> &node_to_color,
                                     bool normalize_colors=false) const;
 
+        // Compute stable coloring of CSR view "m_csr" with its edge labels. With
+        // exact colors, the signature of each node is interned instead of folded
+        // with pairing(), so colors never overflow. Exact colors are { 1, ...,
+        // #colors } in order of first occurrence among nodes, and they do not
+        // depend on the number of threads.
+        int compute_stable_coloring(std::unordered_set<Label> &node_colors,
+                                    std::unordered_multimap<Label, Node> &colors_to_nodes,
+                                    std::unordered_map<Node, Label> &node_to_color,
+                                    const Labels &node_labels,
+                                    const Options &options = Options()) const;
+
+        // Same, but the result is stored in dense arrays.
+        int compute_stable_coloring(Coloring &coloring,
+                                    const Labels &node_labels,
+                                    const Options &options = Options()) const;
+
       private:
-        // A graph.
-        GraphLibrary::Graph m_graph;
+        // A graph, or a CSR view of a graph.
+        const GraphLibrary::Graph *m_graph;
+        const GraphLibrary::CSRGraph *m_csr;
+
+        // Refinement loop over a CSR view, dispatched to refine<true>() for
+        // undirected views and to refine<false>() otherwise.
+        int compute_stable_coloring(const GraphLibrary::CSRGraph &csr,
+                                    Coloring &result,
+                                    const Labels &node_labels,
+                                    const Options &options) const;
+
+        // Refinement loop and its kernels. In an undirected view, the inbound
+        // group of each label is the outbound one, so with "Undirected" each
+        // group is gathered and sorted once, and the colors are the same as
+        // if both groups were processed.
+        template<bool Undirected>
+        int refine(const GraphLibrary::CSRGraph &csr,
+                   Coloring &result,
+                   const Labels &node_labels,
+                   const Options &options) const;
+
+        // Compute exact colors of a round in parallel. Each thread interns the
+        // signatures of a contiguous chunk of nodes in a local table; local
+        // tables are then merged in chunk order, which assigns the same ids as
+        // a sequential pass. Returns the number of colors.
+        template<bool Undirected>
+        Label compute_exact_round(const GraphLibrary::CSRGraph &csr,
+                                  const Labels &coloring,
+                                  Labels &new_coloring,
+                                  const Nodes &chunks,
+                                  std::vector<SignatureTable> &local_signatures,
+                                  std::vector<Labels> &scratch,
+                                  SignatureTable &signatures) const;
+
+        // Color of node "v" in next round folded with pairing(). Buffer
+        // "scratch" is used to sort the colors of each neighbor group.
+        template<bool Undirected>
+        Label get_paired_color(const GraphLibrary::CSRGraph &csr, const Labels &coloring, Node v, Labels &scratch) const;
+
+        // Same as get_paired_color(), but only the non-empty groups of "v" are
+        // folded, each preceded by its group index. Time is proportional to the
+        // degree of "v" rather than to the number of edge labels. The partition
+        // is the same as with get_paired_color() (modulo overflows).
+        template<bool Undirected>
+        Label get_sparse_paired_color(const GraphLibrary::CSRGraph &csr, const Labels &coloring, Node v, Labels &scratch) const;
+
+        // Whether coloring "coloring" (colors { 1, ..., num_colors }), obtained
+        // by a round from "old_coloring" (colors { 1, ... }), is stable. Only
+        // classes with a node adjacent to a class that split in the round can
+        // split; returns false if checking them would cost more than a
+        // fraction of a round. Arcs scanned are added to "num_arcs_scanned".
+        template<bool Undirected>
+        bool is_stable(const GraphLibrary::CSRGraph &csr, const Labels &old_coloring, const Labels &coloring, Label num_colors, size_t &num_arcs_scanned) const;
 
         // Bijection to map two labels to a single label.
         Label pairing(const Label a, const Label b) const {
@@ -0,0 +1,86 @@
+/**********************************************************************
+ * Coloring of the nodes of a graph stored in dense arrays.
+ *
+ * Nodes of the i-th color are nodes_by_color[color_offsets[i] ...
+ * color_offsets[i + 1] - 1] in increasing order, and colors are listed in
+ * order of first occurrence among nodes.
+ *********************************************************************/
+
+#ifndef COLORING_H
+#define COLORING_H
+
+#include <unordered_map>
+#include <unordered_set>
+#include "Graph.h"
+
+namespace ColorRefinement {
+    struct Coloring {
+        // Color of each node.
+        Labels node_to_color;
+        // Distinct colors.
+        Labels colors;
+        // Offsets of the nodes of each color in nodes_by_color (#colors + 1 entries).
+        std::vector<size_t> color_offsets;
+        // Nodes grouped by color.
+        Nodes nodes_by_color;
+
+        size_t get_num_nodes() const {
+            return node_to_color.size();
+        }
+        size_t get_num_colors() const {
+            return colors.size();
+        }
+
+        // Set node colors, and compute colors and nodes by color.
+        void assign(Labels &&node_colors) {
+            node_to_color = std::move(node_colors);
+            size_t num_nodes = node_to_color.size();
+            colors.clear();
+
+            // Index of color of each node. Colors in { 1, ..., #nodes } (as
+            // normalized or exact colors) are indexed without hashing.
+            std::vector<uint> color_index(num_nodes);
+            std::vector<uint> dense_index;
+            std::unordered_map<Label, uint> sparse_index;
+            for( Node v = 0; v < num_nodes; ++v ) {
+                Label color = node_to_color[v];
+                uint index;
+                if( (color > 0) && (color <= num_nodes) ) {
+                    if( dense_index.empty() ) dense_index.assign(1 + num_nodes, uint(-1));
+                    index = dense_index[color];
+                    if( index == uint(-1) ) index = dense_index[color] = colors.size();
+                } else {
+                    auto it = sparse_index.emplace(color, colors.size()).first;
+                    index = it->second;
+                }
+                if( index == colors.size() ) colors.push_back(color);
+                color_index[v] = index;
+            }
+
+            // Counting sort of nodes by color index.
+            color_offsets.assign(1 + colors.size(), 0);
+            for( Node v = 0; v < num_nodes; ++v )
+                ++color_offsets[1 + color_index[v]];
+            for( size_t i = 0; i < colors.size(); ++i )
+                color_offsets[i + 1] += color_offsets[i];
+            nodes_by_color.resize(num_nodes);
+            std::vector<size_t> next(color_offsets.begin(), color_offsets.end() - 1);
+            for( Node v = 0; v < num_nodes; ++v )
+                nodes_by_color[next[color_index[v]]++] = v;
+        }
+
+        // Fill hash-based containers of the legacy API.
+        void get_maps(std::unordered_set<Label> &node_colors,
+                      std::unordered_multimap<Label, Node> &colors_to_nodes,
+                      std::unordered_map<Node, Label> &node_to_color_map) const {
+            node_colors.insert(colors.begin(), colors.end());
+            for( Node v = 0; v < node_to_color.size(); ++v ) {
+                colors_to_nodes.insert({{node_to_color[v], v}});
+                node_to_color_map.insert({{v, node_to_color[v]}});
+            }
+        }
+    };
+}
+
+#endif // COLORING_H
+
@@ -0,0 +1,78 @@
+/**********************************************************************
+ * Buffered writer of colorings.
+ *********************************************************************/
+
+#include "ColoringWriter.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    bool ColoringWriter::parse_format(const string &name, Format &format) {
+        if( name == "text" ) {
+            format = Format::Text;
+        } else if( name == "asp" ) {
+            format = Format::ASP;
+        } else if( name == "binary" ) {
+            format = Format::Binary;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void ColoringWriter::write(const Coloring &coloring, Format format) {
+        if( format == Format::Text )
+            write_text(coloring);
+        else if( format == Format::ASP )
+            write_asp(coloring);
+        else
+            write_binary(coloring);
+    }
+
+    void ColoringWriter::write_text(const Coloring &coloring) {
+        for( size_t i = 0; i < coloring.get_num_colors(); ++i ) {
+            put_uint(coloring.color_offsets[i + 1] - coloring.color_offsets[i]);
+            put(" node(s) with color ");
+            put_uint(coloring.colors[i]);
+            put(" :");
+            for( size_t k = coloring.color_offsets[i]; k < coloring.color_offsets[i + 1]; ++k ) {
+                put(' ');
+                put_uint(coloring.nodes_by_color[k]);
+            }
+            put('\n');
+        }
+        put("total ");
+        put_uint(coloring.get_num_nodes());
+        put(" node(s)\n");
+        for( Node v = 0; v < coloring.get_num_nodes(); ++v ) {
+            put("color(");
+            put_uint(v);
+            put(',');
+            put_uint(coloring.node_to_color[v]);
+            put(")\n");
+        }
+    }
+
+    void ColoringWriter::write_asp(const Coloring &coloring) {
+        for( Node v = 0; v < coloring.get_num_nodes(); ++v ) {
+            put("color(");
+            put_uint(v);
+            put(',');
+            put_uint(coloring.node_to_color[v]);
+            put(").\n");
+        }
+    }
+
+    void ColoringWriter::write_binary(const Coloring &coloring) {
+        uint64_t header[2] = { coloring.get_num_nodes(), coloring.get_num_colors() };
+        put("WLCOLOR\0", 8);
+        put(reinterpret_cast<const char*>(header), sizeof(header));
+        put(reinterpret_cast<const char*>(coloring.node_to_color.data()), sizeof(Label) * coloring.node_to_color.size());
+        put(reinterpret_cast<const char*>(coloring.colors.data()), sizeof(Label) * coloring.colors.size());
+        for( size_t offset : coloring.color_offsets ) {
+            uint64_t value = offset;
+            put(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        put(reinterpret_cast<const char*>(coloring.nodes_by_color.data()), sizeof(Node) * coloring.nodes_by_color.size());
+    }
+}
@@ -0,0 +1,48 @@
+/**********************************************************************
+ * Buffered writer of colorings. Formats are:
+ *
+ *   Text    summary with the nodes of each color, followed by "color(v,c)"
+ *           lines (the output of wl)
+ *   ASP     facts "color(v,c)." for clingo
+ *   Binary  raw dump of the arrays of the coloring: magic "WLCOLOR\0",
+ *           uint64 #nodes, uint64 #colors, then uint64 node_to_color[#nodes],
+ *           uint64 colors[#colors], uint64 color_offsets[#colors + 1] and
+ *           uint32 nodes_by_color[#nodes], in host byte order
+ *********************************************************************/
+
+#ifndef COLORING_WRITER_H
+#define COLORING_WRITER_H
+
+#include <cstdio>
+#include <string>
+#include "BufferedWriter.h"
+#include "Coloring.h"
+
+namespace ColorRefinement {
+    class ColoringWriter : public GraphLibrary::BufferedWriter {
+      public:
+        enum class Format { Text, ASP, Binary };
+
+        // Ctors/dtor. The writer does not close "file", and appends to "str".
+        explicit ColoringWriter(FILE *file, size_t buffer_size = 1 << 20)
+          : GraphLibrary::BufferedWriter(file, buffer_size) {
+        }
+        explicit ColoringWriter(std::string *str, size_t buffer_size = 1 << 16)
+          : GraphLibrary::BufferedWriter(str, buffer_size) {
+        }
+        ~ColoringWriter() { }
+
+        // Parse format name ("text", "asp" or "binary"). Returns false if unknown.
+        static bool parse_format(const std::string &name, Format &format);
+
+        void write(const Coloring &coloring, Format format);
+
+      private:
+        void write_text(const Coloring &coloring);
+        void write_asp(const Coloring &coloring);
+        void write_binary(const Coloring &coloring);
+    };
+}
+
+#endif // COLORING_WRITER_H
+
@@ -0,0 +1,378 @@
+/**********************************************************************
+ * Out-of-core color refinement over a binary graph file (ext .wlg).
+ *********************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <fcntl.h>
+#include <unistd.h>
+#include "BinaryGraph.h"
+#include "ExternalRefinement.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    namespace {
+        // Sequential reader of a section [offset, offset + size) of a file
+        // with large reads. The block size is a multiple of 8 and sections
+        // are 8-byte aligned, so items of 4 or 8 bytes never straddle blocks.
+        class BlockReader {
+          public:
+            BlockReader(int fd, uint64_t offset, uint64_t size, size_t block_size, size_t &num_bytes_read)
+              : m_fd(fd),
+                m_offset(offset),
+                m_end(offset + size),
+                m_buffer((block_size + 7) & ~size_t(7)),
+                m_pos(0),
+                m_size(0),
+                m_ok(true),
+                m_num_bytes_read(num_bytes_read) {
+            }
+
+            template<typename T> const T* next() {
+                if( m_pos == m_size ) fill();
+                if( m_pos + sizeof(T) > m_size ) {
+                    // End of section, or truncated item.
+                    m_ok = m_ok && (m_size == 0);
+                    return nullptr;
+                }
+                const T *item = reinterpret_cast<const T*>(m_buffer.data() + m_pos);
+                m_pos += sizeof(T);
+                return item;
+            }
+
+            bool ok() const {
+                return m_ok;
+            }
+
+          private:
+            const int m_fd;
+            uint64_t m_offset;
+            const uint64_t m_end;
+            std::vector<char> m_buffer;
+            size_t m_pos;
+            size_t m_size;
+            bool m_ok;
+            size_t &m_num_bytes_read;
+
+            void fill() {
+                m_pos = 0;
+                m_size = 0;
+                size_t size = min<uint64_t>(m_buffer.size(), m_end - m_offset);
+                while( m_size < size ) {
+                    ssize_t n = pread(m_fd, m_buffer.data() + m_size, size - m_size, m_offset + m_size);
+                    if( (n < 0) && (errno == EINTR) ) continue;
+                    if( n <= 0 ) {
+                        m_ok = false;
+                        break;
+                    }
+                    m_size += n;
+                }
+                m_offset += m_size;
+                m_num_bytes_read += m_size;
+            }
+        };
+
+        bool write_all(int fd, const void *data, size_t size) {
+            const char *p = static_cast<const char*>(data);
+            while( size > 0 ) {
+                ssize_t n = write(fd, p, size);
+                if( (n < 0) && (errno == EINTR) ) continue;
+                if( n <= 0 ) return false;
+                p += n;
+                size -= n;
+            }
+            return true;
+        }
+
+        // Records are { node, length, signature[length] } in arrays of labels.
+        inline bool less_signature(const Label *a, const Label *b) {
+            return lexicographical_compare(a + 2, a + 2 + a[1], b + 2, b + 2 + b[1]);
+        }
+        inline bool equal_signature(const Label *a, const Label *b) {
+            return (a[1] == b[1]) && equal(a + 2, a + 2 + a[1], b + 2);
+        }
+
+        // Sorted run of records, in memory or in a temporary file.
+        struct Run {
+            int fd;
+            std::unique_ptr<BlockReader> reader;
+            const Labels *buffer;
+            std::vector<size_t> *order;
+            size_t index;
+            Labels record;
+
+            Run() : fd(-1), buffer(nullptr), order(nullptr), index(0) { }
+            ~Run() {
+                if( fd != -1 ) close(fd);
+            }
+
+            // Load next record. Returns false at the end of the run.
+            bool next() {
+                if( buffer != nullptr ) {
+                    if( index == order->size() ) return false;
+                    const Label *r = buffer->data() + (*order)[index++];
+                    record.assign(r, r + 2 + r[1]);
+                    return true;
+                }
+                const Label *node = reader->next<Label>();
+                if( node == nullptr ) return false;
+                record.assign(1, *node);
+                const Label *length = reader->next<Label>();
+                if( length == nullptr ) return false;
+                record.push_back(*length);
+                for( Label i = 0; i < *length; ++i ) {
+                    const Label *word = reader->next<Label>();
+                    if( word == nullptr ) return false;
+                    record.push_back(*word);
+                }
+                return true;
+            }
+        };
+    }
+
+    int ExternalRefinement::compute_stable_coloring(Coloring &result, const Options &options, string &error) {
+        GraphLibrary::BinaryHeader header;
+        vector<GraphLibrary::BinaryLabel> labels;
+        if( !GraphLibrary::read_binary_header(m_filename, header, labels, error) ) return -1;
+        m_num_nodes = header.num_nodes;
+        m_num_arcs = header.num_arcs;
+        m_num_runs = 0;
+        m_num_bytes_read = 0;
+
+        int fd = open(m_filename.c_str(), O_RDONLY);
+        if( fd == -1 ) {
+            error = "opening file '" + m_filename + "'";
+            return -1;
+        }
+        unique_ptr<int, void(*)(int*)> fd_closer(&fd, [](int *f) { close(*f); });
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        // Labels as in make_csr_graph(): dropped labels map to uint(-1), and
+        // kept labels are renumbered in order.
+        bool all_chosen = true;
+        for( const GraphLibrary::BinaryLabel &label : labels )
+            all_chosen = all_chosen && (label.chosen != 0);
+        vector<uint> new_label(labels.size());
+        uint num_edge_labels = 0;
+        for( size_t label = 0; label < labels.size(); ++label ) {
+            if( m_use_chosen_labels && !all_chosen && (labels[label].chosen == 0) ) {
+                new_label[label] = uint(-1);
+            } else {
+                new_label[label] = num_edge_labels++;
+            }
+        }
+
+        // Initial colors, with { 1, ... } since color 0 is the marker as in
+        // ColorRefinement.
+        Node num_nodes = m_num_nodes;
+        Labels coloring(num_nodes, 0);
+        Labels new_coloring(num_nodes, 1);
+        if( !m_uniform_initial_coloring ) {
+            BlockReader reader(fd, header.node_colors_offset, sizeof(Label) * num_nodes, options.block_size, m_num_bytes_read);
+            for( Node v = 0; v < num_nodes; ++v ) {
+                const Label *color = reader.next<Label>();
+                if( color == nullptr ) {
+                    error = "reading file '" + m_filename + "'";
+                    return -1;
+                }
+                new_coloring[v] = *color;
+            }
+            if( find(new_coloring.begin(), new_coloring.end(), 0) != new_coloring.end() ) {
+                for( Label &color : new_coloring )
+                    ++color;
+            }
+        }
+
+        auto start_time = chrono::steady_clock::now();
+        bool stable = false;
+        uint num_old_colors = -1;
+        uint num_new_colors = 1; // just to make it different
+        int num_iterations = 0;
+        Labels buffer;
+        vector<size_t> order;
+        while( num_new_colors != num_old_colors ) {
+            if( (options.max_rounds > 0) && (num_iterations >= int(options.max_rounds)) ) break;
+            if( (options.time_budget > 0) && (num_iterations > 0) &&
+                (chrono::duration<double>(chrono::steady_clock::now() - start_time).count() >= options.time_budget) ) break;
+
+            auto start_round = chrono::steady_clock::now();
+            coloring.swap(new_coloring);
+            num_old_colors = num_new_colors;
+            ++num_iterations;
+
+            // Stream both directions, producing a record per node. Full
+            // buffers are sorted and written as runs.
+            vector<unique_ptr<Run> > runs;
+            buffer.clear();
+            order.clear();
+            BlockReader out_offsets(fd, header.outbound_offsets_offset, sizeof(Edge) * (num_nodes + 1), options.block_size, m_num_bytes_read);
+            BlockReader in_offsets(fd, header.inbound_offsets_offset, sizeof(Edge) * (num_nodes + 1), options.block_size, m_num_bytes_read);
+            BlockReader out_arcs(fd, header.outbound_arcs_offset, sizeof(GraphLibrary::CSRGraph::Arc) * m_num_arcs, options.block_size, m_num_bytes_read);
+            BlockReader in_arcs(fd, header.inbound_arcs_offset, sizeof(GraphLibrary::CSRGraph::Arc) * m_num_arcs, options.block_size, m_num_bytes_read);
+            const Edge *offset = out_offsets.next<Edge>();
+            Edge out_begin = offset == nullptr ? 0 : *offset;
+            offset = in_offsets.next<Edge>();
+            Edge in_begin = offset == nullptr ? 0 : *offset;
+            bool ok = true;
+            for( Node v = 0; ok && (v < num_nodes); ++v ) {
+                size_t start = buffer.size();
+                buffer.push_back(v);
+                buffer.push_back(0);
+                buffer.push_back(coloring[v]);
+                for( int direction = 0; ok && (direction < 2); ++direction ) {
+                    BlockReader &offsets = direction == 0 ? out_offsets : in_offsets;
+                    BlockReader &arcs = direction == 0 ? out_arcs : in_arcs;
+                    Edge &begin = direction == 0 ? out_begin : in_begin;
+                    offset = offsets.next<Edge>();
+                    if( offset == nullptr ) {
+                        ok = false;
+                        break;
+                    }
+                    Edge end = *offset;
+                    uint group_label = uint(-1);
+                    size_t pos = 0;
+                    for( Edge e = begin; e < end; ++e ) {
+                        const GraphLibrary::CSRGraph::Arc *arc = arcs.next<GraphLibrary::CSRGraph::Arc>();
+                        if( (arc == nullptr) || (arc->node >= num_nodes) || (arc->label >= new_label.size()) ) {
+                            ok = false;
+                            break;
+                        }
+                        uint label = new_label[arc->label];
+                        if( label == uint(-1) ) continue;
+                        if( label != group_label ) {
+                            if( group_label != uint(-1) ) {
+                                buffer[pos + 1] = buffer.size() - pos - 2;
+                                sort_colors(buffer.data() + pos + 2, buffer.data() + buffer.size());
+                            }
+                            group_label = label;
+                            pos = buffer.size();
+                            buffer.push_back(direction * num_edge_labels + label);
+                            buffer.push_back(0);
+                        }
+                        buffer.push_back(coloring[arc->node]);
+                    }
+                    if( group_label != uint(-1) ) {
+                        buffer[pos + 1] = buffer.size() - pos - 2;
+                        sort_colors(buffer.data() + pos + 2, buffer.data() + buffer.size());
+                    }
+                    begin = end;
+                }
+                buffer[start + 1] = buffer.size() - start - 2;
+                order.push_back(start);
+
+                // Write run.
+                if( sizeof(Label) * buffer.size() + sizeof(size_t) * order.size() >= options.memory_budget ) {
+                    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return less_signature(buffer.data() + a, buffer.data() + b); });
+                    string path = options.temp_dir + "/wl-run-XXXXXX";
+                    unique_ptr<Run> run(new Run);
+                    run->fd = mkstemp(&path[0]);
+                    if( run->fd == -1 ) {
+                        error = "creating temporary file in '" + options.temp_dir + "'";
+                        return -1;
+                    }
+                    unlink(path.c_str());
+                    Labels block;
+                    size_t block_words = max<size_t>(1, options.block_size / sizeof(Label));
+                    size_t size = 0;
+                    for( size_t i = 0; i < order.size(); ++i ) {
+                        const Label *record = buffer.data() + order[i];
+                        block.insert(block.end(), record, record + 2 + record[1]);
+                        if( (block.size() >= block_words) || (i + 1 == order.size()) ) {
+                            if( !write_all(run->fd, block.data(), sizeof(Label) * block.size()) ) {
+                                error = "writing temporary file in '" + options.temp_dir + "'";
+                                return -1;
+                            }
+                            size += sizeof(Label) * block.size();
+                            block.clear();
+                        }
+                    }
+                    run->reader.reset(new BlockReader(run->fd, 0, size, options.block_size, m_num_bytes_read));
+                    runs.push_back(std::move(run));
+                    ++m_num_runs;
+                    buffer.clear();
+                    order.clear();
+                }
+            }
+            if( !ok || !out_offsets.ok() || !in_offsets.ok() || !out_arcs.ok() || !in_arcs.ok() ) {
+                error = "reading file '" + m_filename + "'";
+                return -1;
+            }
+
+            // Last run stays in memory.
+            sort(order.begin(), order.end(), [&](size_t a, size_t b) { return less_signature(buffer.data() + a, buffer.data() + b); });
+            unique_ptr<Run> run(new Run);
+            run->buffer = &buffer;
+            run->order = &order;
+            runs.push_back(std::move(run));
+
+            // Merge runs, ranking distinct signatures.
+            auto greater = [&](size_t a, size_t b) { return less_signature(runs[b]->record.data(), runs[a]->record.data()); };
+            priority_queue<size_t, vector<size_t>, decltype(greater)> heap(greater);
+            for( size_t i = 0; i < runs.size(); ++i ) {
+                if( runs[i]->next() ) heap.push(i);
+            }
+            Label rank = 0;
+            Labels previous;
+            while( !heap.empty() ) {
+                size_t i = heap.top();
+                heap.pop();
+                const Labels &record = runs[i]->record;
+                if( (rank == 0) || !equal_signature(previous.data(), record.data()) ) {
+                    ++rank;
+                    previous = record;
+                }
+                new_coloring[record[0]] = rank;
+                if( runs[i]->next() ) heap.push(i);
+            }
+            for( size_t i = 0; i < runs.size(); ++i ) {
+                if( (runs[i]->reader != nullptr) && !runs[i]->reader->ok() ) {
+                    error = "reading temporary file in '" + options.temp_dir + "'";
+                    return -1;
+                }
+            }
+
+            // Colors in order of first occurrence.
+            Labels color_of_rank(1 + rank, 0);
+            Label num_colors = 0;
+            for( Node v = 0; v < num_nodes; ++v ) {
+                Label &color = color_of_rank[new_coloring[v]];
+                if( color == 0 ) color = ++num_colors;
+                new_coloring[v] = color;
+            }
+            num_new_colors = num_colors;
+
+            if( options.round_stats != nullptr ) {
+                RoundStats stats;
+                stats.elapsed_time = chrono::duration<double>(chrono::steady_clock::now() - start_round).count();
+                get_round_stats(coloring.data(), new_coloring.data(), num_nodes, stats);
+                stats.num_arcs_scanned = 2 * m_num_arcs;
+                options.round_stats->push_back(stats);
+            }
+
+            // A discrete coloring is stable: the last round is skipped but
+            // counted, as in ColorRefinement.
+            bool round_left = (options.max_rounds == 0) || (num_iterations < int(options.max_rounds));
+            if( (num_iterations > 1) && round_left && (num_new_colors == num_nodes) && (num_new_colors != num_old_colors) ) {
+                ++num_iterations;
+                stable = true;
+                if( options.round_stats != nullptr ) {
+                    RoundStats stats;
+                    stats.elapsed_time = 0;
+                    get_round_stats(new_coloring.data(), new_coloring.data(), num_nodes, stats);
+                    options.round_stats->push_back(stats);
+                }
+                break;
+            }
+        }
+        if( options.stable != nullptr ) *options.stable = stable || (num_new_colors == num_old_colors);
+
+        result.assign(std::move(new_coloring));
+        return num_iterations;
+    }
+}
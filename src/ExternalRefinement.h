@@ -0,0 +1,102 @@
+/**********************************************************************
+ * Out-of-core color refinement over a binary graph file (ext .wlg).
+ *
+ * Only the arcs are out of core. Arrays indexed by node stay in memory:
+ * the colors of the current and next round, and the map from the rank of
+ * a signature to its color (one entry per color, so up to one per node).
+ * Memory is thus linear in the number of nodes. Each round streams the
+ * outbound and inbound CSR sections of the file (arcs sorted by source
+ * and by target) with large sequential reads, and builds the signature of
+ * each node as it streams: groups are keyed by direction * #labels +
+ * label, which induces the same partition as get_signature() of
+ * SignatureTable.h. Signatures are buffered up to a memory budget; full
+ * buffers are sorted and written as runs to temporary files, which are
+ * then merged. Each distinct signature gets the rank of its node of
+ * smallest id, so that colors are { 1, ..., #colors } in order of first
+ * occurrence, exactly as the colors of the in-memory engine.
+ *********************************************************************/
+
+#ifndef EXTERNAL_REFINEMENT_H
+#define EXTERNAL_REFINEMENT_H
+
+#include <string>
+#include <vector>
+#include "ColorRefinement.h"
+#include "Coloring.h"
+#include "Graph.h"
+
+namespace ColorRefinement {
+    class ExternalRefinement {
+      public:
+        struct Options {
+            // Bytes of signatures buffered before a run is written.
+            size_t memory_budget;
+            // Size of sequential reads and writes.
+            size_t block_size;
+            // Directory of temporary files (runs are unlinked once created).
+            std::string temp_dir;
+            // Limits on rounds and time, as in ColorRefinement's Options.
+            uint max_rounds;
+            double time_budget;
+            // If not null, set to whether the coloring is stable.
+            bool *stable;
+            // If not null, statistics of each round are appended (arcs
+            // scanned are the arcs streamed from the file).
+            std::vector<RoundStats> *round_stats;
+
+            Options()
+              : memory_budget(size_t(256) << 20),
+                block_size(size_t(4) << 20),
+                temp_dir("/tmp"),
+                max_rounds(0),
+                time_budget(0),
+                stable(nullptr),
+                round_stats(nullptr) {
+            }
+        };
+
+        // Ctors/dtor. Edge labels and initial colors are handled as by
+        // make_csr_graph() of BinaryGraph.
+        ExternalRefinement(const std::string &filename, bool uniform_initial_coloring, bool use_chosen_labels)
+          : m_filename(filename),
+            m_uniform_initial_coloring(uniform_initial_coloring),
+            m_use_chosen_labels(use_chosen_labels),
+            m_num_nodes(0),
+            m_num_arcs(0),
+            m_num_runs(0),
+            m_num_bytes_read(0) {
+        }
+        ~ExternalRefinement() { }
+
+        // Compute stable coloring. Returns the number of iterations, or -1
+        // and sets "error" on I/O error.
+        int compute_stable_coloring(Coloring &coloring, const Options &options, std::string &error);
+
+        // Size of graph, number of runs written and bytes read (graph and
+        // runs) over all rounds.
+        size_t get_num_nodes() const {
+            return m_num_nodes;
+        }
+        size_t get_num_arcs() const {
+            return m_num_arcs;
+        }
+        size_t get_num_runs() const {
+            return m_num_runs;
+        }
+        size_t get_num_bytes_read() const {
+            return m_num_bytes_read;
+        }
+
+      private:
+        const std::string m_filename;
+        const bool m_uniform_initial_coloring;
+        const bool m_use_chosen_labels;
+        size_t m_num_nodes;
+        size_t m_num_arcs;
+        size_t m_num_runs;
+        size_t m_num_bytes_read;
+    };
+}
+
+#endif // EXTERNAL_REFINEMENT_H
+
@@ -0,0 +1,274 @@
+/**********************************************************************
+ * Seeded generators of synthetic graphs for benchmarks.
+ *********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "Generators.h"
+
+using namespace std;
+
+namespace GraphLibrary {
+    namespace {
+        inline uint64_t key(Node src, Node dst) {
+            return (uint64_t(src) << 32) | dst;
+        }
+
+        // Set nodes (with given colors) and unique arcs (sorted) of graph,
+        // with labels "l0", "l1", ... chosen.
+        void make_graph(size_t num_nodes, vector<uint64_t> &arcs, const Labels &arc_labels, const Labels &node_colors, uint num_labels, LPGraph &lp_graph) {
+            lp_graph = LPGraph();
+            lp_graph.num_nodes = num_nodes;
+            lp_graph.node_colors = node_colors;
+            for( size_t i = 0; i < arcs.size(); ++i ) {
+                lp_graph.edges_src.push_back(arcs[i] >> 32);
+                lp_graph.edges_dst.push_back(arcs[i] & 0xffffffffUL);
+                lp_graph.edge_labels.push_back(arc_labels.empty() ? 0 : arc_labels[i]);
+            }
+            for( uint label = 0; label < num_labels; ++label ) {
+                lp_graph.label_names.emplace(label, "\"l" + to_string(label) + "\"");
+                lp_graph.chosen_labels.insert(label);
+            }
+        }
+
+        // Sort arcs and remove duplicates.
+        void unique_arcs(vector<uint64_t> &arcs) {
+            sort(arcs.begin(), arcs.end());
+            arcs.erase(unique(arcs.begin(), arcs.end()), arcs.end());
+        }
+
+        // Random simple undirected graph where each node has given degree,
+        // as a list of edges (u, v). The configuration model pairs copies
+        // of nodes at random; self-loops and multiple edges are then removed
+        // by swapping endpoints with random pairs. Returns false and sets
+        // "error" if some remain after 1000 passes.
+        bool random_regular_edges(size_t num_nodes, uint degree, mt19937_64 &rng, vector<pair<Node, Node> > &edges, string &error) {
+            edges.clear();
+            vector<Node> points;
+            for( Node v = 0; v < num_nodes; ++v )
+                points.insert(points.end(), degree, v);
+            shuffle(points.begin(), points.end(), rng);
+            size_t num_pairs = points.size() / 2;
+            if( num_pairs < 2 ) return true;
+
+            vector<size_t> bad;
+            vector<pair<uint64_t, size_t> > keys;
+            for( int pass = 0; true; ++pass ) {
+                keys.clear();
+                for( size_t i = 0; i < num_pairs; ++i ) {
+                    Node u = points[2 * i], v = points[2 * i + 1];
+                    keys.emplace_back(key(min(u, v), max(u, v)), i);
+                }
+                sort(keys.begin(), keys.end());
+                bad.clear();
+                for( size_t i = 0; i < num_pairs; ++i ) {
+                    uint64_t k = keys[i].first;
+                    if( ((k >> 32) == (k & 0xffffffffUL)) || ((i > 0) && (keys[i - 1].first == k)) )
+                        bad.push_back(keys[i].second);
+                }
+                if( bad.empty() ) break;
+                if( pass + 1 == 1000 ) {
+                    error = "no simple " + to_string(degree) + "-regular graph on " + to_string(num_nodes) + " nodes found after 1000 passes";
+                    return false;
+                }
+                uniform_int_distribution<size_t> pick(0, num_pairs - 1);
+                for( size_t i : bad )
+                    swap(points[2 * i + 1], points[2 * pick(rng) + 1]);
+            }
+
+            for( size_t i = 0; i < num_pairs; ++i )
+                edges.emplace_back(points[2 * i], points[2 * i + 1]);
+            return true;
+        }
+    }
+
+    const vector<string>& get_generator_names() {
+        static const vector<string> names = { "er", "regular", "grid", "powerlaw", "cfi", "cfi-twisted", "planning" };
+        return names;
+    }
+
+    bool generate_graph(const string &generator, size_t num_edges, uint64_t seed, LPGraph &lp_graph, string &error) {
+        if( generator == "er" ) {
+            generate_erdos_renyi(num_edges, seed, lp_graph);
+        } else if( generator == "regular" ) {
+            return generate_random_regular(num_edges, 3, seed, lp_graph, error);
+        } else if( generator == "grid" ) {
+            generate_grid(num_edges, lp_graph);
+        } else if( generator == "powerlaw" ) {
+            generate_power_law(num_edges, 2.5, seed, lp_graph);
+        } else if( (generator == "cfi") || (generator == "cfi-twisted") ) {
+            return generate_cfi(num_edges, generator == "cfi-twisted", seed, lp_graph, error);
+        } else if( generator == "planning" ) {
+            generate_planning(num_edges, 8, seed, lp_graph);
+        } else {
+            error = "unknown generator '" + generator + "'";
+            return false;
+        }
+        return true;
+    }
+
+    void generate_erdos_renyi(size_t num_edges, uint64_t seed, LPGraph &lp_graph) {
+        mt19937_64 rng(seed);
+        size_t num_nodes = max<size_t>(4, num_edges / 8);
+        num_edges = min(num_edges, num_nodes * (num_nodes - 1));
+        uniform_int_distribution<Node> node(0, num_nodes - 1);
+        vector<uint64_t> arcs;
+        while( arcs.size() < num_edges ) {
+            while( arcs.size() < num_edges ) {
+                Node src = node(rng), dst = node(rng);
+                if( src != dst ) arcs.push_back(key(src, dst));
+            }
+            unique_arcs(arcs);
+        }
+        make_graph(num_nodes, arcs, Labels(), Labels(num_nodes, 1), 1, lp_graph);
+    }
+
+    bool generate_random_regular(size_t num_edges, uint degree, uint64_t seed, LPGraph &lp_graph, string &error) {
+        mt19937_64 rng(seed);
+        size_t num_nodes = max<size_t>(degree + 1, num_edges / degree);
+        if( (num_nodes * degree) % 2 == 1 ) ++num_nodes;
+        vector<pair<Node, Node> > edges;
+        if( !random_regular_edges(num_nodes, degree, rng, edges, error) ) return false;
+        vector<uint64_t> arcs;
+        for( const pair<Node, Node> &edge : edges ) {
+            arcs.push_back(key(edge.first, edge.second));
+            arcs.push_back(key(edge.second, edge.first));
+        }
+        unique_arcs(arcs);
+        make_graph(num_nodes, arcs, Labels(), Labels(num_nodes, 1), 1, lp_graph);
+        return true;
+    }
+
+    void generate_grid(size_t num_edges, LPGraph &lp_graph) {
+        // A k x k grid has 4k(k - 1) arcs.
+        size_t k = 2;
+        while( 4 * (k + 1) * k <= num_edges ) ++k;
+        vector<uint64_t> arcs;
+        for( Node r = 0; r < k; ++r ) {
+            for( Node c = 0; c < k; ++c ) {
+                Node v = r * k + c;
+                if( c + 1 < k ) {
+                    arcs.push_back(key(v, v + 1));
+                    arcs.push_back(key(v + 1, v));
+                }
+                if( r + 1 < k ) {
+                    arcs.push_back(key(v, v + k));
+                    arcs.push_back(key(v + k, v));
+                }
+            }
+        }
+        unique_arcs(arcs);
+        make_graph(k * k, arcs, Labels(), Labels(k * k, 1), 1, lp_graph);
+    }
+
+    void generate_power_law(size_t num_edges, double exponent, uint64_t seed, LPGraph &lp_graph) {
+        // Chung-Lu: endpoints are drawn with probability proportional to
+        // weights (i + 1)^(-1 / (exponent - 1)).
+        mt19937_64 rng(seed);
+        size_t num_nodes = max<size_t>(4, num_edges / 8);
+        vector<double> weights(num_nodes);
+        for( size_t i = 0; i < num_nodes; ++i )
+            weights[i] = pow(double(i + 1), -1.0 / (exponent - 1));
+        discrete_distribution<Node> node(weights.begin(), weights.end());
+
+        // Heavy nodes make duplicates common, so stop after a few attempts.
+        vector<uint64_t> arcs;
+        for( int attempt = 0; (attempt < 16) && (arcs.size() < num_edges); ++attempt ) {
+            while( arcs.size() < num_edges ) {
+                Node src = node(rng), dst = node(rng);
+                if( src != dst ) arcs.push_back(key(src, dst));
+            }
+            unique_arcs(arcs);
+        }
+        make_graph(num_nodes, arcs, Labels(), Labels(num_nodes, 1), 1, lp_graph);
+    }
+
+    bool generate_cfi(size_t num_edges, bool twisted, uint64_t seed, LPGraph &lp_graph, string &error) {
+        // Base: random 3-regular graph on k nodes. Each base node v has a
+        // node a(v,S) for each even subset S of its 3 edges, and nodes
+        // b(v,e,0) and b(v,e,1) for each edge e; a(v,S) is adjacent to
+        // b(v,e,1) if e is in S and to b(v,e,0) otherwise. For each base
+        // edge e = {u,v}, b(u,e,i) is adjacent to b(v,e,i), except for the
+        // twisted edge where it is adjacent to b(v,e,1-i). Each base node
+        // gives 10 nodes and 30 arcs.
+        mt19937_64 rng(seed);
+        size_t k = max<size_t>(4, num_edges / 30);
+        k += k % 2;
+        vector<pair<Node, Node> > base;
+        if( !random_regular_edges(k, 3, rng, base, error) ) return false;
+
+        // Position of each edge among the edges of its endpoints.
+        vector<vector<size_t> > incident(k);
+        for( size_t e = 0; e < base.size(); ++e ) {
+            incident[base[e].first].push_back(e);
+            incident[base[e].second].push_back(e);
+        }
+        auto a_node = [&](Node v, uint subset) { return Node(10 * v + subset); };
+        auto b_node = [&](Node v, size_t e, uint bit) {
+            size_t i = find(incident[v].begin(), incident[v].end(), e) - incident[v].begin();
+            return Node(10 * v + 4 + 2 * i + bit);
+        };
+
+        vector<uint64_t> arcs;
+        Labels node_colors(10 * k, 2);
+        for( Node v = 0; v < k; ++v ) {
+            uint num_subsets = 0;
+            for( uint subset = 0; subset < 8; ++subset ) {
+                if( __builtin_popcount(subset) % 2 == 1 ) continue;
+                Node a = a_node(v, num_subsets++);
+                node_colors[a] = 1;
+                for( size_t i = 0; i < incident[v].size(); ++i ) {
+                    Node b = b_node(v, incident[v][i], (subset >> i) & 1);
+                    arcs.push_back(key(a, b));
+                    arcs.push_back(key(b, a));
+                }
+            }
+        }
+        for( size_t e = 0; e < base.size(); ++e ) {
+            Node u = base[e].first, v = base[e].second;
+            for( uint bit = 0; bit < 2; ++bit ) {
+                Node x = b_node(u, e, bit), y = b_node(v, e, (twisted && (e == 0)) ? 1 - bit : bit);
+                arcs.push_back(key(x, y));
+                arcs.push_back(key(y, x));
+            }
+        }
+        unique_arcs(arcs);
+        make_graph(10 * k, arcs, Labels(), node_colors, 1, lp_graph);
+        return true;
+    }
+
+    void generate_planning(size_t num_edges, uint num_predicates, uint64_t seed, LPGraph &lp_graph) {
+        // Predicate p has arity 1 + p % 3. Atoms have distinct arguments, and
+        // the arc from an atom to its i-th argument has label 3p + i. Objects
+        // have color 1 and atoms of predicate p color 2 + p.
+        mt19937_64 rng(seed);
+        size_t num_atoms = max<size_t>(4, num_edges / 2);
+        size_t num_objects = max<size_t>(4, num_atoms / 4);
+        uniform_int_distribution<uint> predicate(0, num_predicates - 1);
+        uniform_int_distribution<Node> object(0, num_objects - 1);
+
+        vector<uint64_t> arcs;
+        Labels arc_labels;
+        Labels node_colors(num_objects, 1);
+        vector<pair<uint64_t, Label> > labeled;
+        for( size_t i = 0; (i < num_atoms) && (labeled.size() < num_edges); ++i ) {
+            Node atom = num_objects + i;
+            uint p = predicate(rng);
+            node_colors.push_back(2 + p);
+            Node args[3];
+            for( uint j = 0; j < 1 + p % 3; ++j ) {
+                do {
+                    args[j] = object(rng);
+                } while( find(args, args + j, args[j]) != args + j );
+                labeled.emplace_back(key(atom, args[j]), 3 * p + j);
+            }
+        }
+        sort(labeled.begin(), labeled.end());
+        for( const pair<uint64_t, Label> &arc : labeled ) {
+            arcs.push_back(arc.first);
+            arc_labels.push_back(arc.second);
+        }
+        make_graph(node_colors.size(), arcs, arc_labels, node_colors, 3 * num_predicates, lp_graph);
+    }
+}
@@ -0,0 +1,51 @@
+/**********************************************************************
+ * Seeded generators of synthetic graphs for benchmarks.
+ *
+ * Each generator builds a graph with about the given number of edges
+ * (edge/1 atoms, so an undirected edge counts twice), with no duplicate
+ * edges, and fills an LPGraph that write_lp_file() writes as a clingo file.
+ * All labels are chosen. The same seed gives the same graph.
+ *
+ *   er           directed Erdos-Renyi graph with average out-degree 8
+ *   regular      random undirected 3-regular graph, the hardest case for
+ *                WL: refinement stops at once, with a single color
+ *   grid         undirected square grid
+ *   powerlaw     directed Chung-Lu graph with degrees following a power
+ *                law of exponent 2.5
+ *   cfi          Cai-Furer-Immerman graph over a random 3-regular base
+ *                graph; "cfi-twisted" is the same graph with one twisted
+ *                edge. The two are not isomorphic but WL does not
+ *                distinguish them
+ *   planning     planning-style graph: atoms of 8 predicates of arity 1
+ *                to 3 over objects, with an edge from each atom to each
+ *                argument labeled by predicate and position
+ *********************************************************************/
+
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LPReader.h"
+
+namespace GraphLibrary {
+    // Names of generators.
+    const std::vector<std::string>& get_generator_names();
+
+    // Generate graph with given generator. Returns false and sets "error"
+    // if the generator is unknown or fails.
+    bool generate_graph(const std::string &generator, size_t num_edges, uint64_t seed, LPGraph &lp_graph, std::string &error);
+
+    // Regular and CFI graphs return false and set "error" if no simple
+    // regular (base) graph was found.
+    void generate_erdos_renyi(size_t num_edges, uint64_t seed, LPGraph &lp_graph);
+    bool generate_random_regular(size_t num_edges, uint degree, uint64_t seed, LPGraph &lp_graph, std::string &error);
+    void generate_grid(size_t num_edges, LPGraph &lp_graph);
+    void generate_power_law(size_t num_edges, double exponent, uint64_t seed, LPGraph &lp_graph);
+    bool generate_cfi(size_t num_edges, bool twisted, uint64_t seed, LPGraph &lp_graph, std::string &error);
+    void generate_planning(size_t num_edges, uint num_predicates, uint64_t seed, LPGraph &lp_graph);
+}
+
+#endif // GENERATORS_H
+
@@ -21,6 +21,7 @@
 #define GRAPH_H
 
 #include <algorithm>
+#include <cassert>
 #include <set>
 #include <unordered_set>
 #include <vector>
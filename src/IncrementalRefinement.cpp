@@ -0,0 +1,272 @@
+/**********************************************************************
+ * Incremental computation of the Weisfeiler-Leman stable coloring.
+ *********************************************************************/
+
+#include <algorithm>
+#include "IncrementalRefinement.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    IncrementalRefinement::IncrementalRefinement(const GraphLibrary::Graph &graph)
+      : m_directed(graph.directed()),
+        m_node_labels(graph.get_node_labels()),
+        m_outbound(graph.get_num_nodes()),
+        m_inbound(graph.get_num_nodes()),
+        m_is_touched(graph.get_num_nodes(), false) {
+        for( Edge e = 0; e < graph.get_num_edges(); ++e ) {
+            Node v = graph.get_src(e), w = graph.get_dst(e);
+            Label label = graph.get_edge_labels()[e];
+            m_outbound[v].push_back(Arc{ w, label });
+            m_inbound[w].push_back(Arc{ v, label });
+        }
+        rebuild();
+    }
+
+    IncrementalRefinement::IncrementalRefinement(const GraphLibrary::CSRGraph &csr)
+      : m_directed(csr.directed()),
+        m_node_labels(csr.get_node_labels()),
+        m_outbound(csr.get_num_nodes()),
+        m_inbound(csr.get_num_nodes()),
+        m_is_touched(csr.get_num_nodes(), false) {
+        for( Node v = 0; v < csr.get_num_nodes(); ++v ) {
+            for( const GraphLibrary::CSRGraph::Arc *a = csr.outbound_begin(v); a != csr.outbound_end(v); ++a )
+                m_outbound[v].push_back(Arc{ a->node, a->label });
+            for( const GraphLibrary::CSRGraph::Arc *a = csr.inbound_begin(v); a != csr.inbound_end(v); ++a )
+                m_inbound[v].push_back(Arc{ a->node, a->label });
+        }
+        rebuild();
+    }
+
+    Node IncrementalRefinement::add_node(Label label) {
+        Node v = m_node_labels.size();
+        m_node_labels.push_back(label);
+        m_outbound.emplace_back();
+        m_inbound.emplace_back();
+        m_is_touched.push_back(false);
+        for( Labels &colors : m_colors )
+            colors.push_back(0);
+        touch(v);
+        return v;
+    }
+
+    void IncrementalRefinement::add_edge(Node v, Node w, Label label) {
+        assert((v < get_num_nodes()) && (w < get_num_nodes()));
+        m_outbound[v].push_back(Arc{ w, label });
+        m_inbound[w].push_back(Arc{ v, label });
+        if( !m_directed ) {
+            m_outbound[w].push_back(Arc{ v, label });
+            m_inbound[v].push_back(Arc{ w, label });
+        }
+        touch(v);
+        touch(w);
+    }
+
+    bool IncrementalRefinement::remove_edge(Node v, Node w, Label label) {
+        assert((v < get_num_nodes()) && (w < get_num_nodes()));
+        const vector<Arc> &arcs = m_outbound[v];
+        if( none_of(arcs.begin(), arcs.end(), [&](const Arc &a) { return (a.node == w) && (a.label == label); }) )
+            return false;
+        remove_arc(m_outbound[v], w, label);
+        remove_arc(m_inbound[w], v, label);
+        if( !m_directed ) {
+            remove_arc(m_outbound[w], v, label);
+            remove_arc(m_inbound[v], w, label);
+        }
+        touch(v);
+        touch(w);
+        return true;
+    }
+
+    void IncrementalRefinement::remove_incident_edges(Node v) {
+        vector<Arc> outbound, inbound;
+        outbound.swap(m_outbound[v]);
+        inbound.swap(m_inbound[v]);
+        for( const Arc &a : outbound ) {
+            if( a.node == v ) continue;
+            remove_arc(m_inbound[a.node], v, a.label);
+            touch(a.node);
+        }
+        for( const Arc &a : inbound ) {
+            if( a.node == v ) continue;
+            remove_arc(m_outbound[a.node], v, a.label);
+            touch(a.node);
+        }
+        touch(v);
+    }
+
+    void IncrementalRefinement::set_node_label(Node v, Label label) {
+        m_node_labels[v] = label;
+        touch(v);
+    }
+
+    size_t IncrementalRefinement::update() {
+        size_t work = 0;
+        if( m_touched.empty() ) return work;
+
+        // Round 0: colors of touched nodes are their labels.
+        Nodes changed, new_changed, dirty;
+        for( Node v : m_touched ) {
+            ++work;
+            if( recolor(0, v) ) changed.push_back(v);
+        }
+
+        // Round r: recolor touched nodes and neighbors of nodes that changed
+        // color in round r - 1. Stop at the first stable round.
+        m_is_dirty.resize(get_num_nodes(), false);
+        int num_rounds = get_num_rounds();
+        int stable_round = -1;
+        for( int r = 1; r <= num_rounds; ++r ) {
+            dirty.clear();
+            for( Node v : m_touched ) {
+                m_is_dirty[v] = true;
+                dirty.push_back(v);
+            }
+            for( Node v : changed ) {
+                for( const vector<Arc> *arcs : { &m_outbound[v], &m_inbound[v] } ) {
+                    for( const Arc &a : *arcs ) {
+                        if( !m_is_dirty[a.node] ) {
+                            m_is_dirty[a.node] = true;
+                            dirty.push_back(a.node);
+                        }
+                    }
+                }
+            }
+
+            new_changed.clear();
+            for( Node v : dirty ) {
+                m_is_dirty[v] = false;
+                ++work;
+                if( recolor(r, v) ) new_changed.push_back(v);
+            }
+            changed.swap(new_changed);
+
+            if( m_num_colors[r] == m_num_colors[r - 1] ) {
+                stable_round = r;
+                break;
+            }
+        }
+
+        for( Node v : m_touched )
+            m_is_touched[v] = false;
+        m_touched.clear();
+
+        // Drop rounds after the stable one, or add rounds if not yet stable.
+        if( stable_round != -1 ) {
+            m_colors.resize(1 + stable_round);
+            m_tables.resize(1 + stable_round);
+            m_counts.resize(1 + stable_round);
+            m_num_colors.resize(1 + stable_round);
+        } else {
+            extend();
+            work += get_num_nodes() * (get_num_rounds() - num_rounds);
+        }
+
+        // Rebuild when most interned signatures are no longer used.
+        size_t num_live = 0, num_dead = 0;
+        for( size_t r = 0; r < m_tables.size(); ++r ) {
+            num_live += m_num_colors[r];
+            num_dead += m_tables[r].size() - m_num_colors[r];
+        }
+        if( num_dead > num_live + get_num_nodes() ) {
+            work += get_num_nodes() * (1 + get_num_rounds());
+            rebuild();
+        }
+        return work;
+    }
+
+    void IncrementalRefinement::get_coloring(Coloring &coloring) const {
+        const Labels &colors = m_colors.back();
+        vector<Label> normalized(1 + m_tables.back().size(), 0);
+        Labels node_colors(get_num_nodes());
+        Label num_colors = 0;
+        for( Node v = 0; v < get_num_nodes(); ++v ) {
+            if( normalized[colors[v]] == 0 )
+                normalized[colors[v]] = ++num_colors;
+            node_colors[v] = normalized[colors[v]];
+        }
+        coloring.assign(std::move(node_colors));
+    }
+
+    void IncrementalRefinement::touch(Node v) {
+        if( !m_is_touched[v] ) {
+            m_is_touched[v] = true;
+            m_touched.push_back(v);
+        }
+    }
+
+    void IncrementalRefinement::remove_arc(vector<Arc> &arcs, Node node, Label label) {
+        for( size_t i = 0; i < arcs.size(); ++i ) {
+            if( (arcs[i].node == node) && (arcs[i].label == label) ) {
+                arcs[i] = arcs.back();
+                arcs.pop_back();
+                return;
+            }
+        }
+        assert(0);
+    }
+
+    void IncrementalRefinement::get_signature(int r, Node v) {
+        const Labels &colors = m_colors[r - 1];
+        m_signature.clear();
+        m_signature.push_back(colors[v]);
+        for( int direction = 0; direction < 2; ++direction ) {
+            const vector<Arc> &arcs = direction == 0 ? m_outbound[v] : m_inbound[v];
+            m_group.clear();
+            for( const Arc &a : arcs )
+                m_group.emplace_back(a.label, colors[a.node]);
+            sort(m_group.begin(), m_group.end());
+
+            // Each (direction, label) group: direction, label, size, sorted colors.
+            for( size_t i = 0; i < m_group.size(); ) {
+                size_t j = i;
+                while( (j < m_group.size()) && (m_group[j].first == m_group[i].first) ) ++j;
+                m_signature.push_back(direction);
+                m_signature.push_back(m_group[i].first);
+                m_signature.push_back(j - i);
+                for( ; i < j; ++i )
+                    m_signature.push_back(m_group[i].second);
+            }
+        }
+    }
+
+    bool IncrementalRefinement::recolor(int r, Node v) {
+        if( r == 0 ) {
+            m_signature.assign(1, m_node_labels[v]);
+        } else {
+            get_signature(r, v);
+        }
+        Label color = m_tables[r].intern(m_signature.data(), m_signature.size());
+        Label old_color = m_colors[r][v];
+        if( color == old_color ) return false;
+
+        vector<size_t> &counts = m_counts[r];
+        if( counts.size() <= color ) counts.resize(1 + color, 0);
+        if( (old_color != 0) && (--counts[old_color] == 0) ) --m_num_colors[r];
+        if( counts[color]++ == 0 ) ++m_num_colors[r];
+        m_colors[r][v] = color;
+        return true;
+    }
+
+    void IncrementalRefinement::extend() {
+        while( (m_colors.size() < 2) || (m_num_colors.back() != m_num_colors[m_num_colors.size() - 2]) ) {
+            int r = m_colors.size();
+            m_colors.emplace_back(get_num_nodes(), 0);
+            m_tables.emplace_back();
+            m_counts.emplace_back();
+            m_num_colors.push_back(0);
+            for( Node v = 0; v < get_num_nodes(); ++v )
+                recolor(r, v);
+        }
+    }
+
+    void IncrementalRefinement::rebuild() {
+        m_colors.assign(1, Labels(get_num_nodes(), 0));
+        m_tables.assign(1, SignatureTable());
+        m_counts.assign(1, vector<size_t>());
+        m_num_colors.assign(1, 0);
+        for( Node v = 0; v < get_num_nodes(); ++v )
+            recolor(0, v);
+        extend();
+    }
+}
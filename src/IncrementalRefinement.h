@@ -0,0 +1,118 @@
+/**********************************************************************
+ * Incremental computation of the Weisfeiler-Leman stable coloring.
+ *
+ * The engine keeps the exact coloring of every round up to the stable
+ * one, together with a persistent signature table and color counts for
+ * each round. After a batch of edits (node insertions, edge insertions
+ * and removals, node relabelings), update() recomputes the color of a
+ * node in round r only if the node was touched by an edit or one of its
+ * neighbors changed color in round r - 1. The work of an update is thus
+ * proportional to the part of the graph whose colors may change, not to
+ * the size of the graph.
+ *
+ * Since colors of a round are ids of interned signatures, the coloring
+ * of each round is the one of a fresh run (up to renaming of colors), and
+ * the stable partition is the one computed by ColorRefinement. Signatures
+ * that are no longer used are dropped by a full rebuild once they
+ * outnumber the live ones.
+ *********************************************************************/
+
+#ifndef INCREMENTAL_REFINEMENT_H
+#define INCREMENTAL_REFINEMENT_H
+
+#include <vector>
+#include "CSRGraph.h"
+#include "Coloring.h"
+#include "Graph.h"
+#include "SignatureTable.h"
+
+namespace ColorRefinement {
+    class IncrementalRefinement {
+      public:
+        // Ctors/dtor. The engine keeps its own copy of the nodes, edges and
+        // labels of "graph"; as in Graph, undirected edges are stored as two
+        // arcs. The stable coloring is computed on construction.
+        explicit IncrementalRefinement(const GraphLibrary::Graph &graph);
+        // Same, from the arcs and node labels of a CSR view.
+        explicit IncrementalRefinement(const GraphLibrary::CSRGraph &csr);
+        ~IncrementalRefinement() { }
+
+        // Edits. They take effect on the next call to update().
+        Node add_node(Label label = 0);
+        void add_edge(Node v, Node w, Label label = 0);
+        // Remove one edge (v,w) with given label. Returns false if there is none.
+        bool remove_edge(Node v, Node w, Label label = 0);
+        // Remove all edges incident to "v".
+        void remove_incident_edges(Node v);
+        void set_node_label(Node v, Label label);
+
+        // Recompute stable coloring after edits. Returns the number of
+        // (node, round) colors that were recomputed.
+        size_t update();
+
+        // Number of nodes and rounds, and stable coloring (as of last update()).
+        size_t get_num_nodes() const {
+            return m_node_labels.size();
+        }
+        int get_num_rounds() const {
+            return m_colors.size() - 1;
+        }
+        size_t get_num_colors() const {
+            return m_num_colors.back();
+        }
+        Label get_color(Node v) const {
+            return m_colors.back()[v];
+        }
+
+        // Get stable coloring with colors { 1, ..., #colors } in order of first
+        // occurrence, as computed by ColorRefinement with exact colors.
+        void get_coloring(Coloring &coloring) const;
+
+      private:
+        struct Arc {
+            Node node;
+            Label label;
+        };
+
+        bool m_directed;
+        Labels m_node_labels;
+        std::vector<std::vector<Arc> > m_outbound;
+        std::vector<std::vector<Arc> > m_inbound;
+
+        // For each round r: color of each node (ids in table of round r, or
+        // 0 for nodes not colored yet), signature table, number of nodes of
+        // each color, and number of colors in use. Round 0 interns labels.
+        std::vector<Labels> m_colors;
+        std::vector<SignatureTable> m_tables;
+        std::vector<std::vector<size_t> > m_counts;
+        std::vector<size_t> m_num_colors;
+
+        // Nodes touched by edits since last update().
+        Nodes m_touched;
+        std::vector<bool> m_is_touched;
+
+        // Scratch.
+        std::vector<bool> m_is_dirty;
+        Labels m_signature;
+        std::vector<std::pair<Label, Label> > m_group;
+
+        void touch(Node v);
+        void remove_arc(std::vector<Arc> &arcs, Node node, Label label);
+
+        // Signature of "v" in round "r" (r > 0) from colors of round r - 1.
+        void get_signature(int r, Node v);
+
+        // Set color of "v" in round "r" to interned signature. Returns true
+        // if the color changed.
+        bool recolor(int r, Node v);
+
+        // Append rounds computed from scratch until the coloring is stable.
+        void extend();
+
+        // Recompute all rounds from scratch.
+        void rebuild();
+    };
+}
+
+#endif // INCREMENTAL_REFINEMENT_H
+
@@ -0,0 +1,60 @@
+/**********************************************************************
+ * Joint color refinement of two graphs as a non-isomorphism test.
+ *********************************************************************/
+
+#include "JointRefinement.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    int JointRefinement::distinguish() {
+        size_t n1 = m_graph1.get_num_nodes(), n2 = m_graph2.get_num_nodes();
+        m_num_rounds = 0;
+        m_num_colors = 0;
+        if( n1 != n2 ) return 0;
+
+        // Colors of round r are ids in the table of round r (signatures of
+        // round 0 are the node labels). Counts of the colors of the first
+        // graph are decremented by the nodes of the second one: the
+        // histograms differ as soon as a count would go below zero (a color
+        // of the second graph is more frequent).
+        SignatureTable table;
+        Labels colors1, colors2, old_colors1, old_colors2;
+        vector<size_t> counts;
+        size_t num_old_colors = 0;
+        for( int r = 0; true; ++r ) {
+            m_num_rounds = r + 1;
+            old_colors1.swap(colors1);
+            old_colors2.swap(colors2);
+            colors1.resize(n1);
+            colors2.resize(n2);
+            table.clear();
+
+            for( Node v = 0; v < n1; ++v ) {
+                if( r == 0 )
+                    m_signature.assign(1, m_graph1.get_node_labels()[v]);
+                else
+                    get_signature(m_graph1, old_colors1.data(), v, m_signature);
+                colors1[v] = table.intern(m_signature.data(), m_signature.size());
+            }
+            counts.assign(1 + table.size(), 0);
+            for( Node v = 0; v < n1; ++v )
+                ++counts[colors1[v]];
+            for( Node v = 0; v < n2; ++v ) {
+                if( r == 0 )
+                    m_signature.assign(1, m_graph2.get_node_labels()[v]);
+                else
+                    get_signature(m_graph2, old_colors2.data(), v, m_signature);
+                Label color = table.intern(m_signature.data(), m_signature.size());
+                if( (color >= counts.size()) || (counts[color] == 0) ) return r;
+                --counts[color];
+                colors2[v] = color;
+            }
+
+            // Equal histograms: stop if no color was split.
+            m_num_colors = table.size();
+            if( m_num_colors == num_old_colors ) return -1;
+            num_old_colors = m_num_colors;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/**********************************************************************
+ * Joint color refinement of two graphs as a non-isomorphism test.
+ *
+ * Both graphs are refined together, with colors given by one signature
+ * table per round shared by the two graphs (as for their disjoint union),
+ * so that equal colors mean equal signatures in both graphs. After each
+ * round the histograms of colors of the graphs are compared, and the
+ * refinement stops at the first round where they differ: the graphs are
+ * then not isomorphic. Within a round, the nodes of the second graph are
+ * checked against the counts of the first one as they are colored, so a
+ * difference usually stops the round early. If the joint coloring becomes
+ * stable with equal histograms, WL does not distinguish the graphs.
+ *
+ * Edge labels and node labels must agree between graphs (e.g., label
+ * indices as given by make_csr_graph() of LPReader).
+ *********************************************************************/
+
+#ifndef JOINT_REFINEMENT_H
+#define JOINT_REFINEMENT_H
+
+#include <vector>
+#include "CSRGraph.h"
+#include "SignatureTable.h"
+
+namespace ColorRefinement {
+    class JointRefinement {
+      public:
+        // Ctors/dtor.
+        JointRefinement(const GraphLibrary::CSRGraph &graph1, const GraphLibrary::CSRGraph &graph2)
+          : m_graph1(graph1), m_graph2(graph2), m_num_rounds(0) {
+        }
+        ~JointRefinement() { }
+
+        // Refine until the histograms differ or the coloring is stable.
+        // Returns the round where the graphs are distinguished (0 for the
+        // initial coloring), or -1 if they are not distinguished.
+        int distinguish();
+
+        // Number of rounds computed by distinguish() (the last one possibly
+        // partially), and number of colors of the last complete round.
+        int get_num_rounds() const {
+            return m_num_rounds;
+        }
+        size_t get_num_colors() const {
+            return m_num_colors;
+        }
+
+      private:
+        const GraphLibrary::CSRGraph &m_graph1;
+        const GraphLibrary::CSRGraph &m_graph2;
+        int m_num_rounds;
+        size_t m_num_colors;
+
+        // Scratch.
+        Labels m_signature;
+    };
+}
+
+#endif // JOINT_REFINEMENT_H
+
@@ -0,0 +1,293 @@
+/**********************************************************************
+ * k-dimensional Weisfeiler-Leman refinement (k = 2, 3).
+ *********************************************************************/
+
+#include <algorithm>
+#include <limits>
+#include "KWLRefinement.h"
+#include "SignatureTable.h"
+#include "WorkStealingPool.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    namespace {
+        // Fingerprints are computed modulo the prime 2^61 - 1.
+        const uint64_t PRIME = (uint64_t(1) << 61) - 1;
+
+        // Partial reduction: for any x, the result is congruent to x and is
+        // less than PRIME + 8.
+        inline uint64_t fold(uint64_t x) {
+            return (x & PRIME) + (x >> 61);
+        }
+
+        // Full reduction of a value less than PRIME + 8.
+        inline uint64_t reduce(uint64_t x) {
+            return x >= PRIME ? x - PRIME : x;
+        }
+
+        // Partially reduced product of a < 2^62 and b < 2^32.
+        inline uint64_t multiply(uint64_t a, uint64_t b) {
+            unsigned __int128 x = (unsigned __int128)a * b;
+            return fold(uint64_t(x & PRIME) + uint64_t(x >> 61));
+        }
+
+        // Pseudo-random weight in [0, 2^29) of color for the i-th position of
+        // a code in round "round" (output of splitmix64 seeded with "seed").
+        inline uint32_t weight(uint64_t seed, uint round, uint i, size_t color) {
+            uint64_t x = seed + 0x9e3779b97f4a7c15UL * (1 + (uint64_t(round) << 40) + 8 * uint64_t(color) + i);
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9UL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebUL;
+            return uint32_t((x ^ (x >> 31)) >> 35);
+        }
+
+        // Set colors[t] for each t in [0, num_tuples) to the id of the
+        // interned signature of t. With several threads, each chunk of tuples
+        // is interned in a local table, and local tables are merged in chunk
+        // order. Returns the number of colors.
+        template<typename F>
+        size_t intern_tuples(size_t num_tuples, uint num_threads, vector<uint32_t> &colors, F get_signature) {
+            SignatureTable signatures;
+            if( num_threads <= 1 ) {
+                Labels signature;
+                for( size_t t = 0; t < num_tuples; ++t ) {
+                    get_signature(t, signature);
+                    colors[t] = signatures.intern(signature.data(), signature.size());
+                }
+                return signatures.size();
+            }
+
+            vector<SignatureTable> local_signatures(num_threads);
+            GraphLibrary::parallel_for(num_tuples, num_threads, [&](uint i, size_t begin, size_t end) {
+                Labels signature;
+                for( size_t t = begin; t < end; ++t ) {
+                    get_signature(t, signature);
+                    colors[t] = local_signatures[i].intern(signature.data(), signature.size());
+                }
+            });
+
+            vector<vector<uint32_t> > local_to_global(num_threads);
+            for( uint i = 0; i < num_threads; ++i ) {
+                const SignatureTable &table = local_signatures[i];
+                local_to_global[i].resize(1 + table.size());
+                for( Label id = 1; id <= table.size(); ++id )
+                    local_to_global[i][id] = signatures.intern(table.get_signature(id), table.get_length(id), table.get_hash(id));
+                local_signatures[i] = SignatureTable();
+            }
+
+            GraphLibrary::parallel_for(num_tuples, num_threads, [&](uint i, size_t begin, size_t end) {
+                for( size_t t = begin; t < end; ++t )
+                    colors[t] = local_to_global[i][colors[t]];
+            });
+            return signatures.size();
+        }
+    }
+
+    KWLRefinement::KWLRefinement(const GraphLibrary::Graph &graph, uint k)
+      : m_k(k),
+        m_num_nodes(graph.get_num_nodes()),
+        m_node_labels(graph.get_node_labels()),
+        m_num_tuple_colors(0) {
+        assert((k == 2) || (k == 3));
+        for( Edge e = 0; e < graph.get_num_edges(); ++e )
+            m_arcs.emplace_back(graph.get_src(e), graph.get_dst(e), graph.get_edge_labels()[e]);
+    }
+
+    KWLRefinement::KWLRefinement(const GraphLibrary::CSRGraph &csr, uint k)
+      : m_k(k),
+        m_num_nodes(csr.get_num_nodes()),
+        m_node_labels(csr.get_node_labels()),
+        m_num_tuple_colors(0) {
+        assert((k == 2) || (k == 3));
+        for( Node v = 0; v < m_num_nodes; ++v ) {
+            for( const GraphLibrary::CSRGraph::Arc *a = csr.outbound_begin(v); a != csr.outbound_end(v); ++a )
+                m_arcs.emplace_back(v, a->node, a->label);
+        }
+    }
+
+    size_t KWLRefinement::estimate_memory(size_t num_nodes, uint k) {
+        // Per tuple: two color arrays of uint32, weights (four uint32) and
+        // fingerprints (two uint64) for k = 2 or weights of colors (six
+        // uint32) for k = 3, and signature tables of at most one entry per
+        // tuple (three labels, entry and slots). Plus the matrix of edge types.
+        double num_tuples = k == 2 ? double(num_nodes) * num_nodes : double(num_nodes) * num_nodes * num_nodes;
+        double bytes = num_tuples * (2 * 4 + (k == 2 ? 4 * 4 + 2 * 8 : 6 * 4) + 3 * 8 + 24 + 8) + 4.0 * num_nodes * num_nodes;
+        return bytes >= double(numeric_limits<size_t>::max()) ? numeric_limits<size_t>::max() : size_t(bytes);
+    }
+
+    int KWLRefinement::compute_stable_coloring(Coloring &node_coloring, const Options &options, string &error) {
+        size_t n = m_num_nodes;
+        size_t n2 = n * n;
+        size_t num_tuples = m_k == 2 ? n2 : n2 * n;
+        if( (n > 0) && ((m_k == 2 ? n : n2) > numeric_limits<uint32_t>::max() / n) ) {
+            error = "too many tuples for " + to_string(m_k) + "-WL (" + to_string(n) + " nodes)";
+            return -1;
+        }
+        size_t memory = estimate_memory(n, m_k);
+        if( memory > options.max_memory ) {
+            error = to_string(m_k) + "-WL on " + to_string(n) + " nodes needs up to " + to_string(memory >> 20) +
+                    " MB, more than the limit of " + to_string(options.max_memory >> 20) + " MB";
+            return -1;
+        }
+        uint num_threads = max(1U, min<uint>(options.num_threads, max<size_t>(1, num_tuples / 1024)));
+
+        // Edge types: ids of the sorted labels of the arcs from u to v (0 if none).
+        vector<uint32_t> edge_type(n2, 0);
+        {
+            sort(m_arcs.begin(), m_arcs.end());
+            SignatureTable types;
+            Labels labels;
+            for( size_t i = 0; i < m_arcs.size(); ) {
+                Node u = get<0>(m_arcs[i]), v = get<1>(m_arcs[i]);
+                labels.clear();
+                for( ; (i < m_arcs.size()) && (get<0>(m_arcs[i]) == u) && (get<1>(m_arcs[i]) == v); ++i )
+                    labels.push_back(get<2>(m_arcs[i]));
+                edge_type[u * n + v] = types.intern(labels.data(), labels.size());
+            }
+        }
+
+        // Initial coloring: atomic types of tuples.
+        vector<uint32_t> &colors = m_tuple_colors;
+        colors.assign(num_tuples, 0);
+        size_t num_colors;
+        if( m_k == 2 ) {
+            num_colors = intern_tuples(num_tuples, num_threads, colors, [&](size_t t, Labels &signature) {
+                size_t u = t / n, v = t % n;
+                signature.assign({ m_node_labels[u], m_node_labels[v], u == v, edge_type[u * n + v], edge_type[v * n + u] });
+            });
+        } else {
+            num_colors = intern_tuples(num_tuples, num_threads, colors, [&](size_t t, Labels &signature) {
+                size_t a = t / n2, b = (t / n) % n, c = t % n;
+                signature.assign({ m_node_labels[a], m_node_labels[b], m_node_labels[c], a == b, a == c, b == c,
+                                   edge_type[a * n + b], edge_type[b * n + a], edge_type[a * n + c],
+                                   edge_type[c * n + a], edge_type[b * n + c], edge_type[c * n + b] });
+            });
+        }
+        vector<uint32_t>().swap(edge_type);
+
+        // Refine until the number of colors does not grow. Each round has
+        // fresh weights, and the two fingerprints have independent weights.
+        int num_iterations = 0;
+        size_t num_old_colors = 0;
+        vector<uint32_t> old_colors, x1, x2, y, z;
+        vector<uint64_t> h1, h2;
+        vector<uint32_t> a1, b1, d1, a2, b2, d2;
+        while( num_colors != num_old_colors ) {
+            uint round = num_iterations++;
+            num_old_colors = num_colors;
+            old_colors.swap(colors);
+            colors.resize(num_tuples);
+            const uint32_t *c = old_colors.data();
+
+            if( m_k == 2 ) {
+                // Fingerprints of (u,v) are sum_w x1(u,w) * y(w,v) and sum_w
+                // x2(u,w) * z(w,v), where x1, x2, y and z are weights of the
+                // colors of the pairs. They are products of matrices: y and z
+                // are stored transposed, and rows of x1 and x2 are processed
+                // in blocks that stay in cache. Products are less than 2^58,
+                // so sums are folded every 32 terms.
+                x1.resize(num_tuples);
+                x2.resize(num_tuples);
+                y.resize(num_tuples);
+                z.resize(num_tuples);
+                GraphLibrary::parallel_for(n, num_threads, [&](uint, size_t begin, size_t end) {
+                    for( size_t u = begin; u < end; ++u ) {
+                        for( size_t v = 0; v < n; ++v ) {
+                            x1[u * n + v] = weight(options.seed, round, 0, c[u * n + v]);
+                            x2[u * n + v] = weight(options.seed, round, 1, c[u * n + v]);
+                            y[u * n + v] = weight(options.seed, round, 2, c[v * n + u]);
+                            z[u * n + v] = weight(options.seed, round, 3, c[v * n + u]);
+                        }
+                    }
+                });
+                h1.resize(num_tuples);
+                h2.resize(num_tuples);
+                const size_t block = 16;
+                GraphLibrary::parallel_for((n + block - 1) / block, num_threads, [&](uint, size_t begin, size_t end) {
+                    for( size_t u0 = begin * block; u0 < min(n, end * block); u0 += block ) {
+                        for( size_t v = 0; v < n; ++v ) {
+                            const uint32_t *yv = y.data() + v * n, *zv = z.data() + v * n;
+                            for( size_t u = u0; u < min(n, u0 + block); ++u ) {
+                                const uint32_t *x1u = x1.data() + u * n, *x2u = x2.data() + u * n;
+                                uint64_t s1 = 0, s2 = 0;
+                                size_t w = 0;
+                                for( ; w + 32 <= n; w += 32 ) {
+                                    for( size_t i = w; i < w + 32; ++i ) {
+                                        s1 += uint64_t(x1u[i]) * yv[i];
+                                        s2 += uint64_t(x2u[i]) * zv[i];
+                                    }
+                                    s1 = fold(s1);
+                                    s2 = fold(s2);
+                                }
+                                for( ; w < n; ++w ) {
+                                    s1 += uint64_t(x1u[w]) * yv[w];
+                                    s2 += uint64_t(x2u[w]) * zv[w];
+                                }
+                                s1 = fold(s1);
+                                s2 = fold(s2);
+                                h1[u * n + v] = reduce(s1);
+                                h2[u * n + v] = reduce(s2);
+                            }
+                        }
+                    }
+                });
+                num_colors = intern_tuples(num_tuples, num_threads, colors, [&](size_t t, Labels &signature) {
+                    signature.assign({ c[t], h1[t], h2[t] });
+                });
+            } else {
+                // Fingerprints are sums over w of products of the weights of
+                // the colors of t[1/w], t[2/w] and t[3/w]. The product of the
+                // first two (less than 2^58) is split into 29-bit halves, so
+                // that products with the third are less than 2^58 and sums
+                // are folded every 32 terms.
+                for( vector<uint32_t> *weights : { &a1, &b1, &d1, &a2, &b2, &d2 } )
+                    weights->resize(1 + num_colors);
+                for( size_t color = 0; color <= num_colors; ++color ) {
+                    a1[color] = weight(options.seed, round, 0, color);
+                    b1[color] = weight(options.seed, round, 1, color);
+                    d1[color] = weight(options.seed, round, 2, color);
+                    a2[color] = weight(options.seed, round, 3, color);
+                    b2[color] = weight(options.seed, round, 4, color);
+                    d2[color] = weight(options.seed, round, 5, color);
+                }
+                const uint64_t low = (uint64_t(1) << 29) - 1;
+                num_colors = intern_tuples(num_tuples, num_threads, colors, [&](size_t t, Labels &signature) {
+                    const uint32_t *first = c + (t % n2), *second = c + (t / n2) * n2 + (t % n), *third = c + (t - t % n);
+                    uint64_t high1 = 0, low1 = 0, high2 = 0, low2 = 0;
+                    for( size_t w = 0; w < n; ++w ) {
+                        uint32_t c1 = first[w * n2], c2 = second[w * n], c3 = third[w];
+                        uint64_t ab1 = uint64_t(a1[c1]) * b1[c2], ab2 = uint64_t(a2[c1]) * b2[c2];
+                        high1 += (ab1 >> 29) * d1[c3];
+                        low1 += (ab1 & low) * d1[c3];
+                        high2 += (ab2 >> 29) * d2[c3];
+                        low2 += (ab2 & low) * d2[c3];
+                        if( (w & 31) == 31 ) {
+                            high1 = fold(high1);
+                            low1 = fold(low1);
+                            high2 = fold(high2);
+                            low2 = fold(low2);
+                        }
+                    }
+                    uint64_t s1 = fold(multiply(fold(high1), uint64_t(1) << 29) + fold(low1));
+                    uint64_t s2 = fold(multiply(fold(high2), uint64_t(1) << 29) + fold(low2));
+                    signature.assign({ c[t], reduce(s1), reduce(s2) });
+                });
+            }
+        }
+        m_num_tuple_colors = num_colors;
+
+        // Node colors are colors of tuples (v, ..., v).
+        size_t diagonal = m_k == 2 ? n + 1 : n2 + n + 1;
+        Labels node_colors(n);
+        vector<uint32_t> normalized(1 + num_colors, 0);
+        Label num_node_colors = 0;
+        for( size_t v = 0; v < n; ++v ) {
+            uint32_t color = colors[v * diagonal];
+            if( normalized[color] == 0 )
+                normalized[color] = ++num_node_colors;
+            node_colors[v] = normalized[color];
+        }
+        node_coloring.assign(std::move(node_colors));
+        return num_iterations;
+    }
+}
@@ -0,0 +1,105 @@
+/**********************************************************************
+ * k-dimensional Weisfeiler-Leman refinement (k = 2, 3).
+ *
+ * Colors are assigned to the k-tuples of nodes, stored in a dense array
+ * indexed by t = v1 * n^(k-1) + ... + vk (no hashing of tuples). The
+ * initial color of a tuple is its atomic type: the labels of its nodes,
+ * which of its nodes are equal, and the labels of the edges among them in
+ * each direction. In each round, the new color of t is its old color
+ * together with the multiset, over all nodes w, of the k-tuples of colors
+ * (c(t[1/w]), ..., c(t[k/w])) where t[i/w] replaces the i-th node of t
+ * by w. This is the folklore k-dimensional WL (k-FWL), which is as
+ * powerful as the classical (k+1)-dimensional WL. For k = 2 it
+ * distinguishes graphs that 1-WL cannot (e.g., C6 and two copies of C3).
+ *
+ * The multiset is summarized by two fingerprints: sums over w of the
+ * products of pseudo-random weights in [0, 2^29) of the colors in the
+ * code, modulo the prime p = 2^61 - 1. These need no sorting and, for
+ * k = 2, are products of matrices computed in cache-sized blocks. Colors
+ * are ids of interned (old color, fingerprints) signatures, given in
+ * tuple order as in ColorRefinement, so results do not depend on the
+ * number of threads. Each round takes O(n^(k+1)) time and is split among
+ * threads. Memory is O(n^k): see estimate_memory().
+ *
+ * Colors are therefore exact only with high probability. The difference
+ * of the fingerprints of two different multisets is a nonzero polynomial
+ * of degree k in the weights (counts are less than p), so by the
+ * Schwartz-Zippel lemma they agree with probability at most k / 2^29 if
+ * weights are random. Each round draws fresh weights from the seed, and
+ * the fingerprints have independent weights, so a round merges two
+ * classes that should be different with probability at most
+ * k^2 N^2 / 2^59 for N = n^k tuples, and a run of r rounds fails with
+ * probability at most r k^2 N^2 / 2^59. A run with another seed gives the
+ * same colors unless one of them failed.
+ *********************************************************************/
+
+#ifndef KWL_REFINEMENT_H
+#define KWL_REFINEMENT_H
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "CSRGraph.h"
+#include "Coloring.h"
+#include "Graph.h"
+
+namespace ColorRefinement {
+    class KWLRefinement {
+      public:
+        struct Options {
+            // Number of threads used in each round.
+            uint num_threads;
+            // Maximum number of bytes that the computation may use.
+            size_t max_memory;
+            // Seed of the pseudo-random weights of fingerprints.
+            uint64_t seed;
+
+            Options()
+              : num_threads(1),
+                max_memory(size_t(4) << 30),
+                seed(0) {
+            }
+        };
+
+        // Ctors/dtor. Only k = 2 and k = 3 are supported.
+        KWLRefinement(const GraphLibrary::Graph &graph, uint k);
+        KWLRefinement(const GraphLibrary::CSRGraph &csr, uint k);
+        ~KWLRefinement() { }
+
+        // Upper bound on the bytes used for a graph with "num_nodes" nodes.
+        static size_t estimate_memory(size_t num_nodes, uint k);
+
+        // Compute stable coloring of k-tuples. The coloring of nodes is given
+        // by the colors of the tuples (v, ..., v), numbered { 1, ..., #colors }
+        // in order of first occurrence. Returns the number of iterations, or
+        // -1 and sets "error" if the computation would not fit in memory.
+        int compute_stable_coloring(Coloring &node_coloring, const Options &options, std::string &error);
+
+        // Number of tuples and of tuple colors (after compute_stable_coloring()).
+        size_t get_num_tuples() const {
+            return m_tuple_colors.size();
+        }
+        size_t get_num_tuple_colors() const {
+            return m_num_tuple_colors;
+        }
+
+        // Color of tuple with given index.
+        uint32_t get_tuple_color(size_t index) const {
+            return m_tuple_colors[index];
+        }
+
+      private:
+        uint m_k;
+        size_t m_num_nodes;
+        Labels m_node_labels;
+        // Arcs as (src, dst, label).
+        std::vector<std::tuple<Node, Node, Label> > m_arcs;
+
+        std::vector<uint32_t> m_tuple_colors;
+        size_t m_num_tuple_colors;
+    };
+}
+
+#endif // KWL_REFINEMENT_H
+
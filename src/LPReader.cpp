@@ -0,0 +1,363 @@
+/**********************************************************************
+ * Reader (and writer) of graphs specified in clingo (ASP) programs.
+ *********************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include "BufferedWriter.h"
+#include "LPReader.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace GraphLibrary {
+    namespace {
+        // Open-addressing table that maps names (views into the mapped file)
+        // to ids { 0, 1, ... } in order of insertion.
+        class NameTable {
+          public:
+            NameTable() : m_slots(1024, 0) { }
+
+            uint intern(string_view name) {
+                size_t h = 0xcbf29ce484222325UL;
+                for( char c : name )
+                    h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3UL;
+                size_t mask = m_slots.size() - 1;
+                for( size_t i = h & mask; true; i = (i + 1) & mask ) {
+                    uint slot = m_slots[i];
+                    if( slot == 0 ) {
+                        m_names.push_back(name);
+                        m_slots[i] = m_names.size();
+                        if( 2 * m_names.size() > m_slots.size() )
+                            rehash();
+                        return m_names.size() - 1;
+                    } else if( m_names[slot - 1] == name ) {
+                        return slot - 1;
+                    }
+                }
+            }
+
+            size_t size() const {
+                return m_names.size();
+            }
+            string_view name(uint id) const {
+                return m_names[id];
+            }
+
+          private:
+            vector<string_view> m_names;
+            vector<uint> m_slots;
+
+            void rehash() {
+                m_slots.assign(2 * m_slots.size(), 0);
+                size_t mask = m_slots.size() - 1;
+                for( size_t k = 0; k < m_names.size(); ++k ) {
+                    size_t h = 0xcbf29ce484222325UL;
+                    for( char c : m_names[k] )
+                        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3UL;
+                    size_t i = h & mask;
+                    while( m_slots[i] != 0 ) i = (i + 1) & mask;
+                    m_slots[i] = k + 1;
+                }
+            }
+        };
+
+        inline string_view trim(const char *begin, const char *end) {
+            while( (begin < end) && ((*begin == ' ') || (*begin == '\t')) ) ++begin;
+            while( (end > begin) && ((*(end - 1) == ' ') || (*(end - 1) == '\t')) ) --end;
+            return string_view(begin, end - begin);
+        }
+
+        // Get top-level arguments of term whose opening parenthesis is at
+        // "begin". Returns number of arguments, or -1 if the term is not
+        // well-formed or has more than "max_args" arguments.
+        int get_args(const char *begin, const char *end, string_view *args, int max_args) {
+            int n = 0, depth = 0;
+            const char *arg_begin = begin + 1;
+            for( const char *p = begin; p < end; ++p ) {
+                if( *p == '"' ) {
+                    for( ++p; (p < end) && (*p != '"'); ++p ) {
+                        if( *p == '\\' ) ++p;
+                    }
+                } else if( *p == '(' ) {
+                    ++depth;
+                } else if( (*p == ',') && (depth == 1) ) {
+                    if( n == max_args ) return -1;
+                    args[n++] = trim(arg_begin, p);
+                    arg_begin = p + 1;
+                } else if( *p == ')' ) {
+                    if( --depth == 0 ) {
+                        if( n == max_args ) return -1;
+                        args[n++] = trim(arg_begin, p);
+                        return n;
+                    }
+                }
+            }
+            return -1;
+        }
+
+        inline bool parse_uint(string_view arg, uint &value) {
+            if( arg.empty() ) return false;
+            value = 0;
+            for( char c : arg ) {
+                if( (c < '0') || (c > '9') ) return false;
+                value = 10 * value + (c - '0');
+            }
+            return true;
+        }
+
+        // Get (src, dst) of edge term "(src,dst)".
+        inline bool get_edge(string_view term, string_view *args) {
+            return (term.size() > 0) && (term.front() == '(') && (get_args(term.data(), term.data() + term.size(), args, 2) == 2);
+        }
+
+        inline bool starts_with(const char *begin, const char *end, const char *prefix, size_t len) {
+            return (size_t(end - begin) >= len) && (memcmp(begin, prefix, len) == 0);
+        }
+    }
+
+    bool read_lp_file(const string &filename, LPGraph &lp_graph, string &error) {
+        MappedFile file;
+        if( !file.open(filename) ) {
+            error = "opening file '" + filename + "'";
+            return false;
+        }
+        return read_lp_data(file.data(), file.size(), lp_graph, error);
+    }
+
+    bool read_lp_data(const char *data, size_t size, LPGraph &lp_graph, string &error) {
+        // Nodes are interned on first appearance in any atom; node/1 atoms
+        // then fix their final numbering.
+        const uint undeclared = uint(-1);
+        NameTable names;
+        vector<uint> node_index;
+        vector<tuple<uint, uint, uint>> edges;        // (src, dst, index of edge/1 atom)
+        vector<tuple<uint, uint, uint, size_t>> tlabels; // (src, dst, label, line)
+        vector<pair<uint, uint>> colors;              // (node, color)
+        lp_graph = LPGraph();
+        lp_graph.num_bytes = size;
+
+        string_view args[2], edge_args[2];
+        size_t line = 0;
+        const char *p = data, *end = data + size;
+        while( p < end ) {
+            const char *eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            if( eol == nullptr ) eol = end;
+            ++line;
+
+            bool ok = true;
+            if( starts_with(p, eol, "node(", 5) ) {
+                ok = get_args(p + 4, eol, args, 1) == 1;
+                if( ok ) {
+                    uint node = names.intern(args[0]);
+                    if( node >= node_index.size() ) node_index.resize(1 + node, undeclared);
+                    if( node_index[node] != undeclared ) {
+                        error = "duplicate node '" + string(args[0]) + "' at line " + to_string(line);
+                        return false;
+                    }
+                    node_index[node] = lp_graph.num_nodes++;
+                }
+            } else if( starts_with(p, eol, "edge(", 5) ) {
+                ok = (get_args(p + 4, eol, args, 1) == 1) && get_edge(args[0], edge_args);
+                if( ok ) edges.emplace_back(names.intern(edge_args[0]), names.intern(edge_args[1]), edges.size());
+            } else if( starts_with(p, eol, "tlabel(", 7) ) {
+                uint label = 0;
+                ok = (get_args(p + 6, eol, args, 2) == 2) && get_edge(args[0], edge_args) && parse_uint(args[1], label);
+                if( ok ) tlabels.emplace_back(names.intern(edge_args[0]), names.intern(edge_args[1]), label, line);
+            } else if( starts_with(p, eol, "labelname(", 10) ) {
+                uint index = 0;
+                ok = (get_args(p + 9, eol, args, 2) == 2) && parse_uint(args[0], index);
+                if( ok && !lp_graph.label_names.emplace(index, string(args[1])).second ) {
+                    error = "duplicate label " + to_string(index) + " at line " + to_string(line);
+                    return false;
+                }
+            } else if( starts_with(p, eol, "chosen(", 7) ) {
+                uint label = 0;
+                ok = (get_args(p + 6, eol, args, 1) == 1) && parse_uint(args[0], label);
+                if( ok ) lp_graph.chosen_labels.insert(label);
+            } else if( starts_with(p, eol, "color(", 6) ) {
+                uint color = 0;
+                ok = (get_args(p + 5, eol, args, 2) == 2) && parse_uint(args[1], color);
+                if( ok ) colors.emplace_back(names.intern(args[0]), color);
+            }
+            if( !ok ) {
+                error = "malformed atom at line " + to_string(line) + ": '" + string(p, eol - p) + "'";
+                return false;
+            }
+            p = eol + 1;
+        }
+        node_index.resize(names.size(), undeclared);
+
+        // Translate nodes of edges into node indices.
+        lp_graph.edges_src.resize(edges.size());
+        lp_graph.edges_dst.resize(edges.size());
+        lp_graph.edge_labels.resize(edges.size());
+        for( const tuple<uint, uint, uint> &edge : edges ) {
+            uint src = get<0>(edge), dst = get<1>(edge);
+            if( (node_index[src] == undeclared) || (node_index[dst] == undeclared) ) {
+                error = "edge (" + string(names.name(src)) + "," + string(names.name(dst)) + ") with undeclared node";
+                return false;
+            }
+            lp_graph.edges_src[get<2>(edge)] = node_index[src];
+            lp_graph.edges_dst[get<2>(edge)] = node_index[dst];
+        }
+
+        // Match edges and labels by sorting both by (src, dst).
+        sort(edges.begin(), edges.end());
+        sort(tlabels.begin(), tlabels.end());
+        size_t j = 0;
+        for( size_t i = 0; i < edges.size(); ++i ) {
+            uint src = get<0>(edges[i]), dst = get<1>(edges[i]);
+            if( (i > 0) && (get<0>(edges[i - 1]) == src) && (get<1>(edges[i - 1]) == dst) ) {
+                error = "duplicate edge (" + string(names.name(src)) + "," + string(names.name(dst)) + ")";
+                return false;
+            }
+            while( (j < tlabels.size()) && (make_pair(get<0>(tlabels[j]), get<1>(tlabels[j])) < make_pair(src, dst)) ) ++j;
+            size_t k = j;
+            while( (k < tlabels.size()) && (get<0>(tlabels[k]) == src) && (get<1>(tlabels[k]) == dst) ) ++k;
+            if( k - j != 1 ) {
+                error = "edge (" + string(names.name(src)) + "," + string(names.name(dst)) + ") must have exactly one label (it has " + to_string(k - j) + ")";
+                return false;
+            }
+            lp_graph.edge_labels[get<2>(edges[i])] = get<2>(tlabels[j]);
+            j = k;
+        }
+        for( const tuple<uint, uint, uint, size_t> &tlabel : tlabels ) {
+            if( lp_graph.label_names.find(get<2>(tlabel)) == lp_graph.label_names.end() ) {
+                error = "undeclared label " + to_string(get<2>(tlabel)) + " at line " + to_string(get<3>(tlabel));
+                return false;
+            }
+        }
+
+        // Node colors (first color/2 atom for each node).
+        lp_graph.node_colors.assign(lp_graph.num_nodes, 1);
+        vector<bool> colored(lp_graph.num_nodes, false);
+        for( const pair<uint, uint> &color : colors ) {
+            uint node = node_index[color.first];
+            if( node == undeclared ) {
+                error = "color for undeclared node '" + string(names.name(color.first)) + "'";
+                return false;
+            }
+            if( !colored[node] ) {
+                colored[node] = true;
+                lp_graph.node_colors[node] = color.second;
+            }
+        }
+        return true;
+    }
+
+    bool write_lp_file(const string &filename, const LPGraph &lp_graph, string &error) {
+        FILE *file = fopen(filename.c_str(), "w");
+        if( file == nullptr ) {
+            error = "opening file '" + filename + "'";
+            return false;
+        }
+        bool ok;
+        {
+            BufferedWriter writer(file);
+            for( size_t v = 0; v < lp_graph.num_nodes; ++v ) {
+                writer.put("node(");
+                writer.put_uint(v);
+                writer.put(").\n");
+            }
+            for( size_t i = 0; i < lp_graph.edges_src.size(); ++i ) {
+                writer.put("edge((");
+                writer.put_uint(lp_graph.edges_src[i]);
+                writer.put(',');
+                writer.put_uint(lp_graph.edges_dst[i]);
+                writer.put(")).\ntlabel((");
+                writer.put_uint(lp_graph.edges_src[i]);
+                writer.put(',');
+                writer.put_uint(lp_graph.edges_dst[i]);
+                writer.put("),");
+                writer.put_uint(lp_graph.edge_labels[i]);
+                writer.put(").\n");
+            }
+            for( const pair<const uint, string> &label : lp_graph.label_names ) {
+                writer.put("labelname(");
+                writer.put_uint(label.first);
+                writer.put(',');
+                writer.put(label.second.c_str());
+                writer.put(").\n");
+            }
+            for( uint label : lp_graph.chosen_labels ) {
+                writer.put("chosen(");
+                writer.put_uint(label);
+                writer.put(").\n");
+            }
+            for( size_t v = 0; v < lp_graph.node_colors.size(); ++v ) {
+                writer.put("color(");
+                writer.put_uint(v);
+                writer.put(',');
+                writer.put_uint(lp_graph.node_colors[v]);
+                writer.put(").\n");
+            }
+            ok = writer.flush();
+        }
+        ok = (fclose(file) == 0) && ok;
+        if( !ok ) error = "writing file '" + filename + "'";
+        return ok;
+    }
+
+    Graph make_graph(const LPGraph &lp_graph, bool uniform_initial_coloring, bool use_chosen_labels) {
+        // normalize edge labels
+        map<uint, uint> remap_label;
+        for( map<uint, string>::const_iterator it = lp_graph.label_names.begin(); it != lp_graph.label_names.end(); ++it )
+            remap_label.emplace(it->first, remap_label.size());
+
+        // setup (initial) node colors (if specified), otherwise initial coloring is uniform
+        Labels node_labels(lp_graph.num_nodes, 1);
+        if( !uniform_initial_coloring )
+            node_labels = lp_graph.node_colors;
+
+        // setup edges
+        Labels edge_labels;
+        Nodes edges_src, edges_dst;
+        for( size_t i = 0; i < lp_graph.edges_src.size(); ++i ) {
+            uint label = lp_graph.edge_labels[i];
+            if( !use_chosen_labels || (lp_graph.chosen_labels.find(label) != lp_graph.chosen_labels.end()) ) {
+                edges_src.push_back(lp_graph.edges_src[i]);
+                edges_dst.push_back(lp_graph.edges_dst[i]);
+                edge_labels.push_back(remap_label.at(label));
+            }
+        }
+
+        // construct and return graph
+        return Graph(lp_graph.num_nodes, edges_src, edges_dst, edge_labels, node_labels, true);
+    }
+
+    CSRGraph make_csr_graph(const LPGraph &lp_graph, bool uniform_initial_coloring, bool use_chosen_labels) {
+        Labels node_labels(lp_graph.num_nodes, 1);
+        if( !uniform_initial_coloring )
+            node_labels = lp_graph.node_colors;
+
+        Labels edge_labels;
+        Nodes edges_src, edges_dst;
+        uint num_edge_labels = 0;
+        for( size_t i = 0; i < lp_graph.edges_src.size(); ++i ) {
+            uint label = lp_graph.edge_labels[i];
+            if( !use_chosen_labels || (lp_graph.chosen_labels.find(label) != lp_graph.chosen_labels.end()) ) {
+                edges_src.push_back(lp_graph.edges_src[i]);
+                edges_dst.push_back(lp_graph.edges_dst[i]);
+                edge_labels.push_back(label);
+                num_edge_labels = max(num_edge_labels, label + 1);
+            }
+        }
+        return CSRGraph(lp_graph.num_nodes, edges_src, edges_dst, edge_labels, num_edge_labels, node_labels);
+    }
+
+    CSRGraph make_remapped_csr_graph(const Graph &graph) {
+        map<Label, Label> map_edge_label;
+        Labels edge_labels = graph.get_edge_labels();
+        for( size_t i = 0; i < edge_labels.size(); ++i ) {
+            Label label = edge_labels[i];
+            if( map_edge_label.find(label) == map_edge_label.end() )
+                map_edge_label.emplace(label, map_edge_label.size());
+            edge_labels[i] = map_edge_label[label];
+        }
+        assert(map_edge_label.size() == graph.get_set_edge_labels().size());
+        return CSRGraph(graph, edge_labels, map_edge_label.size());
+    }
+}
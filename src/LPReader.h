@@ -0,0 +1,70 @@
+/**********************************************************************
+ * Reader (and writer) of graphs specified in clingo (ASP) programs.
+ *
+ * The file is memory-mapped and parsed in place: atoms node/1, edge/1,
+ * tlabel/2, labelname/2, chosen/1 and color/2 are recognized at the
+ * beginning of each line, node names are interned as string views into
+ * the mapped file, and no string is allocated per token.
+ *********************************************************************/
+
+#ifndef LP_READER_H
+#define LP_READER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include "CSRGraph.h"
+#include "Graph.h"
+
+namespace GraphLibrary {
+    // Graph as specified in a clingo file. Nodes are numbered in order of
+    // node/1 atoms, and edges in order of edge/1 atoms.
+    struct LPGraph {
+        size_t num_nodes;
+        Nodes edges_src;
+        Nodes edges_dst;
+        // Label index (as in tlabel/2) of each edge.
+        Labels edge_labels;
+        // Color of each node given by color/2 (1 if none).
+        Labels node_colors;
+        // Names of labels given by labelname/2.
+        std::map<uint, std::string> label_names;
+        // Labels given by chosen/1.
+        std::set<uint> chosen_labels;
+        // Size of file in bytes.
+        size_t num_bytes;
+
+        LPGraph() : num_nodes(0), num_bytes(0) { }
+    };
+
+    // Read graph from clingo file (ext .lp). Returns false and sets "error"
+    // if the file cannot be read or is inconsistent.
+    bool read_lp_file(const std::string &filename, LPGraph &lp_graph, std::string &error);
+
+    // Same, for the contents of a clingo file in memory.
+    bool read_lp_data(const char *data, size_t size, LPGraph &lp_graph, std::string &error);
+
+    // Write graph as clingo file: node/1 atoms for nodes { 0, ..., #nodes - 1 },
+    // edge/1 and tlabel/2 atoms for edges, labelname/2 and chosen/1 atoms,
+    // and color/2 atoms. Returns false and sets "error" on I/O error.
+    bool write_lp_file(const std::string &filename, const LPGraph &lp_graph, std::string &error);
+
+    // Construct directed graph. Edge labels are remapped into { 0, ..., #labels - 1 }
+    // in increasing order of label index. Edges whose label is not chosen are
+    // dropped if "use_chosen_labels" is set.
+    Graph make_graph(const LPGraph &lp_graph, bool uniform_initial_coloring, bool use_chosen_labels);
+
+    // Construct CSR view of graph. Edge labels are the label indices (so that
+    // they agree among files), and the number of edge labels is one more than
+    // the largest index. Edges are dropped as in make_graph().
+    CSRGraph make_csr_graph(const LPGraph &lp_graph, bool uniform_initial_coloring, bool use_chosen_labels);
+
+    // Construct CSR view of graph given by make_graph(). Edge labels are
+    // remapped into { 0, ..., #labels - 1 } in order of first occurrence among
+    // the edges, so labels without edges are not counted. This is the view
+    // that wl colors.
+    CSRGraph make_remapped_csr_graph(const Graph &graph);
+}
+
+#endif // LP_READER_H
+
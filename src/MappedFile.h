@@ -0,0 +1,70 @@
+/**********************************************************************
+ * Read-only memory mapping of a file.
+ *********************************************************************/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace GraphLibrary {
+    class MappedFile {
+      public:
+        // Ctors/dtor.
+        MappedFile() : m_data(nullptr), m_size(0) { }
+        MappedFile(const MappedFile &file) = delete;
+        MappedFile& operator=(const MappedFile &file) = delete;
+        ~MappedFile() {
+            close();
+        }
+
+        // Map file into memory. Returns false if file cannot be opened or mapped.
+        bool open(const std::string &filename, bool sequential = true) {
+            close();
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if( fd == -1 ) return false;
+            struct stat st;
+            if( fstat(fd, &st) == -1 ) {
+                ::close(fd);
+                return false;
+            }
+            m_size = st.st_size;
+            if( m_size > 0 ) {
+                void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if( data == MAP_FAILED ) {
+                    ::close(fd);
+                    m_size = 0;
+                    return false;
+                }
+                m_data = static_cast<const char*>(data);
+                if( sequential ) madvise(data, m_size, MADV_SEQUENTIAL);
+            }
+            ::close(fd);
+            return true;
+        }
+
+        void close() {
+            if( m_data != nullptr ) munmap(const_cast<char*>(m_data), m_size);
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        const char* data() const {
+            return m_data;
+        }
+        size_t size() const {
+            return m_size;
+        }
+
+      private:
+        const char *m_data;
+        size_t m_size;
+    };
+}
+
+#endif // MAPPED_FILE_H
+
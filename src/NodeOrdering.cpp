@@ -0,0 +1,112 @@
+/**********************************************************************
+ * Orderings of the nodes of a graph for locality of refinement.
+ *********************************************************************/
+
+#include <algorithm>
+#include "NodeOrdering.h"
+
+using namespace std;
+
+namespace GraphLibrary {
+    namespace {
+        inline size_t get_degree(const CSRGraph &csr, Node v) {
+            return csr.get_out_degree(v) + (csr.directed() ? csr.get_in_degree(v) : 0);
+        }
+
+        // Append the unvisited neighbors of "v" to "queue", marking them.
+        void visit_neighbors(const CSRGraph &csr, Node v, vector<bool> &visited, Nodes &queue) {
+            for( int direction = 0; direction < (csr.directed() ? 2 : 1); ++direction ) {
+                const CSRGraph::Arc *begin = direction == 0 ? csr.outbound_begin(v) : csr.inbound_begin(v);
+                const CSRGraph::Arc *end = direction == 0 ? csr.outbound_end(v) : csr.inbound_end(v);
+                for( const CSRGraph::Arc *a = begin; a != end; ++a ) {
+                    if( !visited[a->node] ) {
+                        visited[a->node] = true;
+                        queue.push_back(a->node);
+                    }
+                }
+            }
+        }
+
+        // Breadth-first order of the nodes, starting each component at the
+        // first unvisited node of "starts". With "by_degree", the neighbors
+        // of a node are visited by increasing degree (Cuthill-McKee).
+        Nodes breadth_first_order(const CSRGraph &csr, const Nodes &starts, bool by_degree) {
+            Node num_nodes = csr.get_num_nodes();
+            vector<bool> visited(num_nodes, false);
+            Nodes order;
+            order.reserve(num_nodes);
+            for( Node s : starts ) {
+                if( visited[s] ) continue;
+                visited[s] = true;
+                order.push_back(s);
+                for( size_t head = order.size() - 1; head < order.size(); ++head ) {
+                    size_t tail = order.size();
+                    visit_neighbors(csr, order[head], visited, order);
+                    if( by_degree ) {
+                        stable_sort(order.begin() + tail, order.end(), [&](Node a, Node b) {
+                            return get_degree(csr, a) < get_degree(csr, b);
+                        });
+                    }
+                }
+            }
+            return order;
+        }
+
+        // Nodes sorted by degree (then by id) with a counting sort.
+        Nodes sort_by_degree(const CSRGraph &csr) {
+            Node num_nodes = csr.get_num_nodes();
+            size_t max_degree = 0;
+            for( Node v = 0; v < num_nodes; ++v )
+                max_degree = max(max_degree, get_degree(csr, v));
+            vector<size_t> offsets(max_degree + 2, 0);
+            for( Node v = 0; v < num_nodes; ++v )
+                ++offsets[get_degree(csr, v) + 1];
+            for( size_t d = 0; d <= max_degree; ++d )
+                offsets[d + 1] += offsets[d];
+            Nodes nodes(num_nodes);
+            for( Node v = 0; v < num_nodes; ++v )
+                nodes[offsets[get_degree(csr, v)]++] = v;
+            return nodes;
+        }
+    }
+
+    bool parse_node_ordering(const string &name, NodeOrdering &ordering) {
+        if( name == "input" ) {
+            ordering = NodeOrdering::Input;
+        } else if( name == "bfs" ) {
+            ordering = NodeOrdering::BFS;
+        } else if( name == "rcm" ) {
+            ordering = NodeOrdering::RCM;
+        } else if( name == "color-degree" ) {
+            ordering = NodeOrdering::ColorDegree;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    Nodes compute_node_ordering(const CSRGraph &csr, NodeOrdering ordering) {
+        Node num_nodes = csr.get_num_nodes();
+        Nodes order(num_nodes);
+        for( Node v = 0; v < num_nodes; ++v )
+            order[v] = v;
+
+        // Nodes in new order.
+        if( ordering == NodeOrdering::BFS ) {
+            order = breadth_first_order(csr, order, false);
+        } else if( ordering == NodeOrdering::RCM ) {
+            order = breadth_first_order(csr, sort_by_degree(csr), true);
+            reverse(order.begin(), order.end());
+        } else if( ordering == NodeOrdering::ColorDegree ) {
+            const Labels &node_labels = csr.get_node_labels();
+            stable_sort(order.begin(), order.end(), [&](Node a, Node b) {
+                return node_labels[a] != node_labels[b] ? node_labels[a] < node_labels[b] : get_degree(csr, a) < get_degree(csr, b);
+            });
+        }
+
+        Nodes new_id(num_nodes);
+        for( Node i = 0; i < num_nodes; ++i )
+            new_id[order[i]] = i;
+        return new_id;
+    }
+}
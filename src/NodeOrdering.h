@@ -0,0 +1,41 @@
+/**********************************************************************
+ * Orderings of the nodes of a graph for locality of refinement.
+ *
+ * Node ids follow the input, so the colors of the neighbors of a node are
+ * read from scattered positions of the coloring. Renumbering the nodes so
+ * that neighbors get close ids turns most of these reads into cache hits:
+ *
+ *   bfs            breadth-first order, from the first node (by id) of
+ *                  each connected component
+ *   rcm            reverse Cuthill-McKee: breadth-first order from a node
+ *                  of minimum degree of each component, visiting neighbors
+ *                  by increasing degree, and reversed; it reduces the
+ *                  bandwidth of the adjacency matrix
+ *   color-degree   nodes grouped by initial color, and by degree within
+ *                  each color
+ *
+ * Arcs are followed in both directions, and degrees count the neighbors
+ * of both directions.
+ *********************************************************************/
+
+#ifndef NODE_ORDERING_H
+#define NODE_ORDERING_H
+
+#include <string>
+#include "CSRGraph.h"
+#include "Graph.h"
+
+namespace GraphLibrary {
+    enum class NodeOrdering { Input, BFS, RCM, ColorDegree };
+
+    // Parse ordering name ("input", "bfs", "rcm" or "color-degree").
+    // Returns false if unknown.
+    bool parse_node_ordering(const std::string &name, NodeOrdering &ordering);
+
+    // New id of each node in the given ordering, a permutation of the nodes
+    // for CSRGraph::permute_nodes().
+    Nodes compute_node_ordering(const CSRGraph &csr, NodeOrdering ordering);
+}
+
+#endif // NODE_ORDERING_H
+
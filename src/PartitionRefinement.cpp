@@ -0,0 +1,364 @@
+/**********************************************************************
+ * Partition refinement engine for the Weisfeiler-Leman stable coloring.
+ *********************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <numeric>
+#include "PartitionRefinement.h"
+#include "SignatureTable.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    namespace {
+        // Splitter passes over an ordered partition, with a worklist of
+        // splitter cells (named by their begin).
+        class Refiner {
+          public:
+            Refiner(const GraphLibrary::CSRGraph &csr, PartitionRefinement::OrderedPartition &partition, bool canonical)
+              : m_csr(csr),
+                m_partition(partition),
+                m_canonical(canonical),
+                m_in_worklist(csr.get_num_nodes(), false),
+                m_group_size(2 * csr.get_num_edge_labels(), 0),
+                m_group_begin(2 * csr.get_num_edge_labels()),
+                m_count(csr.get_num_nodes(), 0),
+                m_cell_size(csr.get_num_nodes(), 0),
+                m_cell_max(csr.get_num_nodes(), 0),
+                m_cell_offset(csr.get_num_nodes()) {
+            }
+
+            void push(uint begin) {
+                if( !m_in_worklist[begin] ) {
+                    m_in_worklist[begin] = true;
+                    m_worklist.push_back(begin);
+                }
+            }
+
+            // Process splitters until the worklist is empty. Returns the number
+            // of splitters, or -1 if "trace" stopped the refinement.
+            int run(const function<bool(size_t)> &trace) {
+                int num_splitters = 0;
+                while( !m_worklist.empty() ) {
+                    // Splitters are taken in order of arrival if canonical.
+                    uint c = m_canonical ? m_worklist.front() : m_worklist.back();
+                    if( m_canonical ) {
+                        m_worklist.pop_front();
+                    } else {
+                        m_worklist.pop_back();
+                    }
+                    m_in_worklist[c] = false;
+                    ++num_splitters;
+                    m_summary.assign({ c, m_partition.size(c) });
+                    if( split_by(c) && trace && !trace(SignatureTable::hash(m_summary.data(), m_summary.size())) )
+                        return -1;
+                }
+                return num_splitters;
+            }
+
+          private:
+            const GraphLibrary::CSRGraph &m_csr;
+            PartitionRefinement::OrderedPartition &m_partition;
+            const bool m_canonical;
+            vector<bool> m_in_worklist;
+            deque<uint> m_worklist;
+
+            // Scratch of splitter passes: arcs of the splitter by group,
+            // neighbors in the splitter of each node (0 for nodes not
+            // touched), touched cells with their numbers of touched nodes,
+            // largest counts and offsets in "m_by_cell", and touched nodes as
+            // (count, node) sorted by cell and count.
+            Nodes m_splitter;
+            vector<size_t> m_group_size, m_group_begin;
+            vector<uint> m_groups;
+            Nodes m_group_nodes;
+            vector<uint> m_count;
+            Nodes m_touched, m_by_cell;
+            vector<uint> m_cells, m_cell_size, m_cell_max, m_bucket, m_parts;
+            vector<size_t> m_cell_offset;
+            vector<pair<uint, Node>> m_hits;
+            // Splits of the current pass, for its trace (if canonical).
+            Labels m_summary;
+
+            // Split cells by the neighbors of their nodes in splitter "c", for
+            // each edge group. Returns whether a cell was split.
+            bool split_by(uint c) {
+                const GraphLibrary::CSRGraph &csr = m_csr;
+                PartitionRefinement::OrderedPartition &partition = m_partition;
+                uint num_edge_labels = csr.get_num_edge_labels();
+                m_splitter.assign(partition.elements.begin() + c, partition.elements.begin() + partition.cell_end[c]);
+
+                // Arcs of the splitter are bucketed by group: the edge label for
+                // edges from a node into the splitter, and num_edge_labels + label
+                // for edges from the splitter into a node. Groups are processed
+                // in order of first occurrence (in increasing order if canonical).
+                m_groups.clear();
+                for( Node w : m_splitter ) {
+                    for( const GraphLibrary::CSRGraph::Arc *a = csr.inbound_begin(w); a != csr.inbound_end(w); ++a ) {
+                        if( m_group_size[a->label]++ == 0 ) m_groups.push_back(a->label);
+                    }
+                    for( const GraphLibrary::CSRGraph::Arc *a = csr.outbound_begin(w); a != csr.outbound_end(w); ++a ) {
+                        if( m_group_size[num_edge_labels + a->label]++ == 0 ) m_groups.push_back(num_edge_labels + a->label);
+                    }
+                }
+                if( m_canonical ) sort(m_groups.begin(), m_groups.end());
+                size_t num_keys = 0;
+                for( uint g : m_groups ) {
+                    m_group_begin[g] = num_keys;
+                    num_keys += m_group_size[g];
+                    m_group_size[g] = 0;
+                }
+                m_group_nodes.resize(num_keys);
+                for( Node w : m_splitter ) {
+                    for( const GraphLibrary::CSRGraph::Arc *a = csr.inbound_begin(w); a != csr.inbound_end(w); ++a )
+                        m_group_nodes[m_group_begin[a->label] + m_group_size[a->label]++] = a->node;
+                    for( const GraphLibrary::CSRGraph::Arc *a = csr.outbound_begin(w); a != csr.outbound_end(w); ++a )
+                        m_group_nodes[m_group_begin[num_edge_labels + a->label] + m_group_size[num_edge_labels + a->label]++] = a->node;
+                }
+
+                // Process each group independently: count neighbors in splitter
+                // for each node, and split cells accordingly. Touched nodes are
+                // bucketed by cell, and then by count with a counting sort over
+                // { 0, ..., largest count }, so a group costs time linear in its
+                // arcs (plus sorting the touched cells if canonical).
+                bool split = false;
+                for( uint g : m_groups ) {
+                    m_touched.clear();
+                    for( size_t i = m_group_begin[g]; i < m_group_begin[g] + m_group_size[g]; ++i ) {
+                        Node v = m_group_nodes[i];
+                        if( m_count[v]++ == 0 ) m_touched.push_back(v);
+                    }
+                    m_group_size[g] = 0;
+
+                    m_cells.clear();
+                    for( Node v : m_touched ) {
+                        uint d = partition.cell[v];
+                        if( m_cell_size[d]++ == 0 ) m_cells.push_back(d);
+                        m_cell_max[d] = max(m_cell_max[d], m_count[v]);
+                    }
+                    if( m_canonical ) sort(m_cells.begin(), m_cells.end());
+                    size_t offset = 0;
+                    for( uint d : m_cells ) {
+                        m_cell_offset[d] = offset;
+                        offset += m_cell_size[d];
+                        m_cell_size[d] = 0;
+                    }
+                    m_by_cell.resize(m_touched.size());
+                    for( Node v : m_touched ) {
+                        uint d = partition.cell[v];
+                        m_by_cell[m_cell_offset[d] + m_cell_size[d]++] = v;
+                    }
+
+                    if( m_canonical ) m_summary.push_back(g);
+                    m_hits.resize(m_touched.size());
+                    for( uint d : m_cells ) {
+                        size_t begin = m_cell_offset[d], end = begin + m_cell_size[d];
+                        m_bucket.assign(m_cell_max[d] + 1, 0);
+                        for( size_t i = begin; i < end; ++i )
+                            ++m_bucket[m_count[m_by_cell[i]]];
+                        for( uint k = 0, sum = 0; k <= m_cell_max[d]; ++k ) {
+                            uint size = m_bucket[k];
+                            m_bucket[k] = sum;
+                            sum += size;
+                        }
+                        for( size_t i = begin; i < end; ++i ) {
+                            Node v = m_by_cell[i];
+                            m_hits[begin + m_bucket[m_count[v]]++] = make_pair(m_count[v], v);
+                        }
+                        m_cell_size[d] = 0;
+                        m_cell_max[d] = 0;
+                        split = split_cell(d, begin, end) || split;
+                    }
+                    for( Node v : m_touched )
+                        m_count[v] = 0;
+                }
+                return split;
+            }
+
+            // Split cell "d" by the neighbor counts of its touched nodes, given
+            // by the hits in [begin, end) sorted by count. Untouched nodes
+            // (count 0) stay first, and parts follow in increasing order of
+            // count. Returns whether the cell was split.
+            bool split_cell(uint d, size_t begin, size_t end) {
+                PartitionRefinement::OrderedPartition &partition = m_partition;
+                uint num_touched = end - begin;
+                if( (num_touched == partition.size(d)) && (m_hits[begin].first == m_hits[end - 1].first) )
+                    return false;
+
+                // Move touched nodes to the tail of the cell, in count order.
+                uint tail = partition.cell_end[d] - num_touched;
+                for( uint i = 0; i < num_touched; ++i ) {
+                    Node v = m_hits[begin + i].second;
+                    Node w = partition.elements[tail + i];
+                    swap(partition.elements[partition.position[v]], partition.elements[tail + i]);
+                    partition.position[w] = partition.position[v];
+                    partition.position[v] = tail + i;
+                }
+
+                // Create one part per count. The first part keeps the begin "d".
+                m_parts.clear();
+                if( tail > d ) {
+                    partition.cell_end[d] = tail;
+                    m_parts.push_back(d);
+                }
+                if( m_canonical ) m_summary.push_back(d);
+                for( size_t i = begin; i < end; ) {
+                    size_t j = i + 1;
+                    while( (j < end) && (m_hits[j].first == m_hits[i].first) ) ++j;
+                    uint part_begin = tail + (i - begin);
+                    uint part_end = tail + (j - begin);
+                    partition.cell_end[part_begin] = part_end;
+                    if( part_begin != d ) {
+                        for( uint k = part_begin; k < part_end; ++k )
+                            partition.cell[partition.elements[k]] = part_begin;
+                    }
+                    m_parts.push_back(part_begin);
+                    if( m_canonical ) {
+                        m_summary.push_back(m_hits[i].first);
+                        m_summary.push_back(j - i);
+                    }
+                    i = j;
+                }
+                partition.num_cells += m_parts.size() - 1;
+
+                // If "d" is still waiting as splitter, all parts must be used as
+                // splitters. Otherwise, the (first) largest part can be skipped.
+                if( m_in_worklist[d] ) {
+                    for( uint p : m_parts )
+                        push(p);
+                } else {
+                    uint largest = m_parts.front();
+                    for( uint p : m_parts ) {
+                        if( partition.size(p) > partition.size(largest) )
+                            largest = p;
+                    }
+                    for( uint p : m_parts ) {
+                        if( p != largest )
+                            push(p);
+                    }
+                }
+                return true;
+            }
+        };
+    }
+
+    PartitionRefinement::OrderedPartition::OrderedPartition(const Labels &node_labels) : num_cells(0) {
+        size_t num_nodes = node_labels.size();
+        elements.resize(num_nodes);
+        position.resize(num_nodes);
+        cell.resize(num_nodes);
+        cell_end.resize(num_nodes);
+        iota(elements.begin(), elements.end(), 0);
+        sort(elements.begin(), elements.end(), [&node_labels](Node v, Node w) {
+            return node_labels[v] < node_labels[w] || (node_labels[v] == node_labels[w] && v < w);
+        });
+        for( uint i = 0; i < num_nodes; ) {
+            uint j = i + 1;
+            while( (j < num_nodes) && (node_labels[elements[j]] == node_labels[elements[i]]) ) ++j;
+            cell_end[i] = j;
+            for( uint k = i; k < j; ++k ) {
+                position[elements[k]] = k;
+                cell[elements[k]] = i;
+            }
+            ++num_cells;
+            i = j;
+        }
+    }
+
+    uint PartitionRefinement::OrderedPartition::individualize(Node v) {
+        uint begin = cell[v], end = cell_end[begin];
+        Node u = elements[begin];
+        swap(elements[begin], elements[position[v]]);
+        position[u] = position[v];
+        position[v] = begin;
+        if( end > begin + 1 ) {
+            cell_end[begin] = begin + 1;
+            cell_end[begin + 1] = end;
+            for( uint i = begin + 1; i < end; ++i )
+                cell[elements[i]] = begin + 1;
+            ++num_cells;
+        }
+        return begin;
+    }
+
+    int PartitionRefinement::compute_stable_coloring(const GraphLibrary::CSRGraph &csr,
+                                                     Coloring &result,
+                                                     const Labels &node_labels) const {
+        Node num_nodes = csr.get_num_nodes();
+        assert(node_labels.size() == num_nodes);
+        OrderedPartition partition(node_labels);
+        Refiner refiner(csr, partition, false);
+        for( uint begin = 0; begin < num_nodes; begin = partition.cell_end[begin] )
+            refiner.push(begin);
+        int num_splitters = refiner.run(nullptr);
+
+        // Number cells in order of first occurrence.
+        Labels cell_color(num_nodes, 0);
+        Labels coloring(num_nodes);
+        Label num_colors = 0;
+        for( Node v = 0; v < num_nodes; ++v ) {
+            uint c = partition.cell[v];
+            if( cell_color[c] == 0 )
+                cell_color[c] = ++num_colors;
+            coloring[v] = cell_color[c];
+        }
+        result.assign(std::move(coloring));
+        return num_splitters;
+    }
+
+    bool PartitionRefinement::refine(OrderedPartition &partition, const vector<uint> &splitters, const function<bool(size_t)> &trace) const {
+        assert(m_csr != nullptr);
+        Refiner refiner(*m_csr, partition, true);
+        for( uint begin : splitters )
+            refiner.push(begin);
+        return refiner.run(trace) >= 0;
+    }
+
+    int PartitionRefinement::compute_stable_coloring(unordered_set<Label> &node_colors,
+                                                     unordered_multimap<Label, Node> &colors_to_nodes,
+                                                     unordered_map<Node, Label> &node_to_color,
+                                                     const Labels &node_labels,
+                                                     uint num_edge_labels,
+                                                     const Labels &edge_labels) const {
+        // Assumption: edge labels are in { 0, ..., num_edge_labels - 1 }.
+        for( Label label : edge_labels )
+            assert(label < num_edge_labels);
+
+        assert(m_graph != nullptr);
+        GraphLibrary::CSRGraph csr(*m_graph, edge_labels, num_edge_labels);
+        Coloring coloring;
+        int num_splitters = compute_stable_coloring(csr, coloring, node_labels);
+        coloring.get_maps(node_colors, colors_to_nodes, node_to_color);
+        return num_splitters;
+    }
+
+    int PartitionRefinement::compute_stable_coloring(unordered_set<Label> &node_colors,
+                                                     unordered_multimap<Label, Node> &colors_to_nodes,
+                                                     unordered_map<Node, Label> &node_to_color) const {
+        if( m_csr != nullptr )
+            return compute_stable_coloring(node_colors, colors_to_nodes, node_to_color, Labels(m_csr->get_num_nodes(), 1));
+        return compute_stable_coloring(node_colors,
+                                       colors_to_nodes,
+                                       node_to_color,
+                                       Labels(m_graph->get_num_nodes(), 1),
+                                       1,
+                                       Labels(m_graph->get_num_edges(), 0));
+    }
+
+    int PartitionRefinement::compute_stable_coloring(unordered_set<Label> &node_colors,
+                                                     unordered_multimap<Label, Node> &colors_to_nodes,
+                                                     unordered_map<Node, Label> &node_to_color,
+                                                     const Labels &node_labels) const {
+        Coloring coloring;
+        int num_splitters = compute_stable_coloring(coloring, node_labels);
+        coloring.get_maps(node_colors, colors_to_nodes, node_to_color);
+        return num_splitters;
+    }
+
+    int PartitionRefinement::compute_stable_coloring(Coloring &coloring, const Labels &node_labels) const {
+        assert(m_csr != nullptr);
+        return compute_stable_coloring(*m_csr, coloring, node_labels);
+    }
+}
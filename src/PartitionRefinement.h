@@ -0,0 +1,122 @@
+/**********************************************************************
+ * Partition refinement engine for the Weisfeiler-Leman stable coloring.
+ *
+ * Instead of recoloring every node in every round, the engine keeps a
+ * worklist of splitter classes. Each splitter C is used to split every
+ * class whose nodes disagree on the number of neighbors in C, for each
+ * edge direction and edge label. When a class that is not queued splits,
+ * all parts but the largest one are queued ("process the smaller half"),
+ * so each node is in O(log n) splitters and O((n + m) log n) arcs are
+ * scanned in total. Each splitter pass groups the arcs it scans by edge
+ * group, and the touched nodes by class and count, with counting sorts
+ * whose cost is linear in those arcs (as in Paige-Tarjan), so the running
+ * time is O((n + m) log n) as well. The result is the
+ * coarsest equitable partition that refines the initial node labels,
+ * which is the partition computed by
+ * ColorRefinement::compute_stable_coloring().
+ *
+ * The engine works on an ordered partition, in which each cell is a range
+ * of an array of the nodes. It can also refine a given ordered partition
+ * from a few splitters (e.g., the singleton cell of a node individualized
+ * by CanonicalLabeling) and canonically: groups, cells and parts are then
+ * processed in order, so the result depends on the graph and on the order
+ * of the cells, but not on the numbering of the nodes.
+ *
+ * See: Berkholz, Bonsma and Grohe. Tight Lower and Upper Bounds for the
+ * Complexity of Canonical Colour Refinement. ESA 2013.
+ *********************************************************************/
+
+#ifndef PARTITION_REFINEMENT_H
+#define PARTITION_REFINEMENT_H
+
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "CSRGraph.h"
+#include "Coloring.h"
+#include "Graph.h"
+
+namespace ColorRefinement {
+    class PartitionRefinement {
+      public:
+        // Ordered partition of the nodes. Each cell is a range [begin,
+        // cell_end[begin]) of "elements", and is named by its begin.
+        struct OrderedPartition {
+            Nodes elements;
+            // Position of each node in "elements", and begin of its cell.
+            std::vector<uint> position;
+            std::vector<uint> cell;
+            // End of the cell that starts at each begin (other entries are
+            // not used).
+            std::vector<uint> cell_end;
+            size_t num_cells;
+
+            OrderedPartition() : num_cells(0) { }
+            // Cells of the nodes with equal labels, in increasing order of label.
+            explicit OrderedPartition(const Labels &node_labels);
+
+            uint size(uint begin) const {
+                return cell_end[begin] - begin;
+            }
+            bool discrete() const {
+                return num_cells == elements.size();
+            }
+
+            // Split node "v" from its cell into a singleton cell placed first.
+            // Returns the begin of the singleton.
+            uint individualize(Node v);
+        };
+
+        // Ctors/dtor.
+        explicit PartitionRefinement(const GraphLibrary::Graph &graph) : m_graph(&graph), m_csr(nullptr) { }
+        explicit PartitionRefinement(const GraphLibrary::CSRGraph &csr) : m_graph(nullptr), m_csr(&csr) { }
+        ~PartitionRefinement() { }
+
+        // Compute stable coloring of graph "m_graph". Colors are numbered
+        // { 1, ..., #classes } in order of first occurrence among nodes (the
+        // same numbering as ColorRefinement with normalized colors). Returns
+        // the number of splitters processed.
+        int compute_stable_coloring(std::unordered_set<Label> &node_colors,
+                                    std::unordered_multimap<Label, Node> &colors_to_nodes,
+                                    std::unordered_map<Node, Label> &node_to_color,
+                                    const Labels &node_labels,
+                                    uint num_edge_labels,
+                                    const Labels &edge_labels) const;
+        int compute_stable_coloring(std::unordered_set<Label> &node_colors,
+                                    std::unordered_multimap<Label, Node> &colors_to_nodes,
+                                    std::unordered_map<Node, Label> &node_to_color) const;
+
+        // Compute stable coloring of CSR view "m_csr" with its edge labels.
+        int compute_stable_coloring(std::unordered_set<Label> &node_colors,
+                                    std::unordered_multimap<Label, Node> &colors_to_nodes,
+                                    std::unordered_map<Node, Label> &node_to_color,
+                                    const Labels &node_labels) const;
+
+        // Same, but the result is stored in dense arrays.
+        int compute_stable_coloring(Coloring &coloring, const Labels &node_labels) const;
+
+        // Refine ordered partition of the nodes of "m_csr" until it is
+        // equitable, with the cells that begin at "splitters" as the first
+        // splitters (the partition must be equitable with respect to the
+        // other cells). Refinement is canonical, and parts of a split cell
+        // are ordered by their number of neighbors in the splitter. After each
+        // splitter pass that splits a cell, a hash of the splits is passed to
+        // "trace", which stops the refinement by returning false. Returns
+        // false if stopped.
+        bool refine(OrderedPartition &partition, const std::vector<uint> &splitters, const std::function<bool(size_t)> &trace) const;
+
+      private:
+        // A graph, or a CSR view of a graph.
+        const GraphLibrary::Graph *m_graph;
+        const GraphLibrary::CSRGraph *m_csr;
+
+        // Refinement over a CSR view.
+        int compute_stable_coloring(const GraphLibrary::CSRGraph &csr,
+                                    Coloring &result,
+                                    const Labels &node_labels) const;
+    };
+}
+
+#endif // PARTITION_REFINEMENT_H
+
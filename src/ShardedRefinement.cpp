@@ -0,0 +1,267 @@
+/**********************************************************************
+ * Color refinement with exact colors sharded over worker processes.
+ *********************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ShardedRefinement.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    namespace {
+        // Anonymous memory shared with forked processes. Pages are only
+        // backed once touched.
+        class SharedArray {
+          public:
+            SharedArray() : m_data(nullptr), m_size(0) { }
+            SharedArray(const SharedArray &array) = delete;
+            SharedArray& operator=(const SharedArray &array) = delete;
+            ~SharedArray() {
+                if( m_data != nullptr ) munmap(m_data, m_size);
+            }
+
+            bool allocate(size_t num_labels) {
+                m_size = max<size_t>(1, num_labels) * sizeof(Label);
+                void *data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if( data == MAP_FAILED ) {
+                    m_size = 0;
+                    return false;
+                }
+                m_data = static_cast<Label*>(data);
+                return true;
+            }
+
+            Label* data() const {
+                return m_data;
+            }
+
+          private:
+            Label *m_data;
+            size_t m_size;
+        };
+
+        // Commands to workers: round or translation of local ids, where the
+        // colors of the current round are colors[0] (upper case) or colors[1].
+        const char Round[2] = { 'R', 'r' };
+        const char Translate[2] = { 'T', 't' };
+
+        bool send_byte(int fd, char c) {
+            for( ;; ) {
+                ssize_t n = send(fd, &c, 1, MSG_NOSIGNAL);
+                if( n == 1 ) return true;
+                if( (n < 0) && (errno == EINTR) ) continue;
+                return false;
+            }
+        }
+        bool recv_byte(int fd, char &c) {
+            for( ;; ) {
+                ssize_t n = recv(fd, &c, 1, 0);
+                if( n == 1 ) return true;
+                if( (n < 0) && (errno == EINTR) ) continue;
+                return false;
+            }
+        }
+    }
+
+    int ShardedRefinement::compute_stable_coloring(Coloring &result,
+                                                   const Labels &node_labels,
+                                                   const Options &options,
+                                                   string &error) const {
+        Node num_nodes = m_csr.get_num_nodes();
+        assert(node_labels.size() == num_nodes);
+        uint num_processes = max(1U, min<uint>(m_num_processes, num_nodes));
+
+        // Shards balanced by number of arcs, as the chunks of threads.
+        Nodes shards(1, 0);
+        size_t total_weight = num_nodes + 2 * m_csr.get_num_edges();
+        size_t weight = 0;
+        for( Node v = 0; v < num_nodes; ++v ) {
+            weight += 1 + m_csr.get_out_degree(v) + m_csr.get_in_degree(v);
+            if( weight * num_processes >= total_weight * shards.size() )
+                shards.push_back(v + 1);
+        }
+        while( shards.size() <= num_processes )
+            shards.push_back(num_nodes);
+
+        // Shared memory: colors of two rounds, local tables (a signature has
+        // at most 1 + 4 * degree labels, plus its length) and maps from local
+        // ids to global ids.
+        vector<size_t> arena_offsets(1, 0);
+        for( size_t s = 0; s < num_processes; ++s ) {
+            size_t size = 1;
+            for( Node v = shards[s]; v < shards[s + 1]; ++v )
+                size += 2 + 4 * (m_csr.get_out_degree(v) + m_csr.get_in_degree(v));
+            arena_offsets.push_back(arena_offsets.back() + size);
+        }
+        SharedArray colors_array, arena_array, maps_array;
+        if( !colors_array.allocate(2 * size_t(num_nodes)) || !arena_array.allocate(arena_offsets.back()) ||
+            !maps_array.allocate(num_nodes + num_processes) ) {
+            error = "allocating shared memory";
+            return -1;
+        }
+        Label *colors[2] = { colors_array.data(), colors_array.data() + num_nodes };
+
+        // Need node labels { 1, ... } since color 0 is marker
+        bool add_one_to_node_labels = find(node_labels.begin(), node_labels.end(), 0) != node_labels.end();
+        for( Node v = 0; v < num_nodes; ++v )
+            colors[0][v] = node_labels[v] + (add_one_to_node_labels ? 1 : 0);
+
+        // Fork workers.
+        vector<int> sockets;
+        vector<pid_t> workers;
+        auto stop_workers = [&]() {
+            for( int fd : sockets )
+                close(fd);
+            for( pid_t pid : workers )
+                waitpid(pid, nullptr, 0);
+        };
+        for( size_t s = 0; s < num_processes; ++s ) {
+            int fds[2];
+            if( socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1 ) {
+                error = "creating socket pair";
+                stop_workers();
+                return -1;
+            }
+            pid_t pid = fork();
+            if( pid == -1 ) {
+                close(fds[0]);
+                close(fds[1]);
+                error = "forking worker process";
+                stop_workers();
+                return -1;
+            } else if( pid == 0 ) {
+                for( int fd : sockets )
+                    close(fd);
+                close(fds[0]);
+                run_worker(s, fds[1], shards, colors, arena_array.data() + arena_offsets[s], maps_array.data() + shards[s] + s);
+                _exit(0);
+            }
+            close(fds[1]);
+            sockets.push_back(fds[0]);
+            workers.push_back(pid);
+        }
+
+        // Send command to all workers and wait until they are done.
+        auto broadcast = [&](char command) {
+            for( int fd : sockets ) {
+                if( !send_byte(fd, command) ) return false;
+            }
+            for( int fd : sockets ) {
+                char reply;
+                if( !recv_byte(fd, reply) || (reply != command) ) return false;
+            }
+            return true;
+        };
+
+        auto start_time = chrono::steady_clock::now();
+        bool stable = false;
+        int num_iterations = 0;
+        uint num_old_colors = -1;
+        uint num_new_colors = 1; // just to make it different
+        int next = 0;
+        SignatureTable signatures;
+        while( num_new_colors != num_old_colors ) {
+            if( (options.max_rounds > 0) && (num_iterations >= int(options.max_rounds)) ) break;
+            if( (options.time_budget > 0) && (num_iterations > 0) &&
+                (chrono::duration<double>(chrono::steady_clock::now() - start_time).count() >= options.time_budget) ) break;
+
+            auto start = chrono::steady_clock::now();
+            int current = next;
+            next = 1 - current;
+            num_old_colors = num_new_colors;
+            ++num_iterations;
+
+            // Workers intern signatures; local tables are merged in shard order.
+            if( !broadcast(Round[current]) ) {
+                error = "worker process failed";
+                stop_workers();
+                return -1;
+            }
+            signatures.clear();
+            for( size_t s = 0; s < num_processes; ++s ) {
+                const Label *table = arena_array.data() + arena_offsets[s];
+                Label *map = maps_array.data() + shards[s] + s;
+                size_t pos = 1;
+                for( Label id = 1; id <= table[0]; ++id ) {
+                    size_t length = table[pos];
+                    map[id] = signatures.intern(table + pos + 1, length);
+                    pos += 1 + length;
+                }
+            }
+            if( !broadcast(Translate[current]) ) {
+                error = "worker process failed";
+                stop_workers();
+                return -1;
+            }
+            num_new_colors = signatures.size();
+
+            // Statistics of the round (peak memory of the coordinator).
+            if( options.round_stats != nullptr ) {
+                RoundStats stats;
+                stats.elapsed_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                get_round_stats(colors[current], colors[next], num_nodes, stats);
+                stats.num_arcs_scanned = (m_csr.directed() ? 2 : 1) * m_csr.get_num_edges();
+                options.round_stats->push_back(stats);
+            }
+
+            // A discrete coloring is stable: the last round is skipped but
+            // counted, as in ColorRefinement.
+            bool round_left = (options.max_rounds == 0) || (num_iterations < int(options.max_rounds));
+            if( options.detect_stability && (num_iterations > 1) && round_left && (num_new_colors == num_nodes) && (num_new_colors != num_old_colors) ) {
+                ++num_iterations;
+                stable = true;
+                if( options.round_stats != nullptr ) {
+                    RoundStats stats;
+                    stats.elapsed_time = 0;
+                    get_round_stats(colors[next], colors[next], num_nodes, stats);
+                    options.round_stats->push_back(stats);
+                }
+                break;
+            }
+        }
+        stop_workers();
+        if( options.stable != nullptr ) *options.stable = stable || (num_new_colors == num_old_colors);
+
+        result.assign(Labels(colors[next], colors[next] + num_nodes));
+        return num_iterations;
+    }
+
+    void ShardedRefinement::run_worker(size_t shard, int fd, const Nodes &shards, Label *colors[2], Label *arena, const Label *map) const {
+        SignatureTable table;
+        Labels signature;
+        for( char command; recv_byte(fd, command); ) {
+            int current = (command == Round[0]) || (command == Translate[0]) ? 0 : 1;
+            const Label *coloring = colors[current];
+            Label *new_coloring = colors[1 - current];
+            if( (command == Round[0]) || (command == Round[1]) ) {
+                table.clear();
+                for( Node v = shards[shard]; v < shards[shard + 1]; ++v ) {
+                    if( m_csr.undirected() )
+                        get_signature<true>(m_csr, coloring, v, signature);
+                    else
+                        get_signature<false>(m_csr, coloring, v, signature);
+                    new_coloring[v] = table.intern(signature.data(), signature.size());
+                }
+                arena[0] = table.size();
+                size_t pos = 1;
+                for( Label id = 1; id <= table.size(); ++id ) {
+                    size_t length = table.get_length(id);
+                    arena[pos] = length;
+                    copy(table.get_signature(id), table.get_signature(id) + length, arena + pos + 1);
+                    pos += 1 + length;
+                }
+            } else {
+                for( Node v = shards[shard]; v < shards[shard + 1]; ++v )
+                    new_coloring[v] = map[new_coloring[v]];
+            }
+            if( !send_byte(fd, command) ) break;
+        }
+        close(fd);
+    }
+}
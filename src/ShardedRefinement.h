@@ -0,0 +1,55 @@
+/**********************************************************************
+ * Color refinement with exact colors sharded over worker processes.
+ *
+ * Nodes are split into contiguous shards balanced by number of arcs, one
+ * per worker process. Workers are forked once the graph is built, so they
+ * share its pages; the colors of the current and next round live in shared
+ * memory, so every worker reads the colors of the neighbors of its nodes
+ * (boundary nodes included) without copies. In each round, each worker
+ * interns the signatures of its nodes in a local table that it writes to
+ * shared memory; the coordinator merges the tables in shard order into the
+ * global table of colors, and the workers translate their local ids. The
+ * colors are thus those of ColorRefinement with exact colors. Workers are
+ * driven over Unix socket pairs (local IPC only).
+ *********************************************************************/
+
+#ifndef SHARDED_REFINEMENT_H
+#define SHARDED_REFINEMENT_H
+
+#include <string>
+#include "CSRGraph.h"
+#include "ColorRefinement.h"
+#include "Coloring.h"
+#include "Graph.h"
+
+namespace ColorRefinement {
+    class ShardedRefinement {
+      public:
+        // Ctors/dtor.
+        ShardedRefinement(const GraphLibrary::CSRGraph &csr, uint num_processes)
+          : m_csr(csr),
+            m_num_processes(num_processes) {
+        }
+        ~ShardedRefinement() { }
+
+        // Compute stable coloring. The limits on rounds and time of "options"
+        // are honored, and "options.stable" is set if not null. Returns the
+        // number of iterations, or -1 and sets "error" if shared memory or
+        // worker processes cannot be set up, or if a worker dies.
+        int compute_stable_coloring(Coloring &coloring,
+                                    const Labels &node_labels,
+                                    const Options &options,
+                                    std::string &error) const;
+
+      private:
+        const GraphLibrary::CSRGraph &m_csr;
+        const uint m_num_processes;
+
+        // Loop of a worker process for shard "shard" on socket "fd". The local
+        // table is written to "arena", and local ids are translated by "map".
+        void run_worker(size_t shard, int fd, const Nodes &shards, Label *colors[2], Label *arena, const Label *map) const;
+    };
+}
+
+#endif // SHARDED_REFINEMENT_H
+
@@ -0,0 +1,154 @@
+/**********************************************************************
+ * Interning of color signatures.
+ *
+ * A signature is a sequence of labels (e.g., the color of a node followed
+ * by the sorted colors of its neighbors). The table maps each distinct
+ * signature to a dense id in { 1, 2, ... } given in order of insertion,
+ * so that colors computed from signatures are exact (no overflows nor
+ * collisions) and small enough to index arrays.
+ *
+ * All engines build the signature of a node with get_signature(), so that
+ * signatures of different engines, and of different graphs, agree.
+ *********************************************************************/
+
+#ifndef SIGNATURE_TABLE_H
+#define SIGNATURE_TABLE_H
+
+#include <algorithm>
+#include <vector>
+#include "CSRGraph.h"
+#include "Graph.h"
+
+namespace ColorRefinement {
+    // Sort colors of a neighbor group. Groups are usually tiny, so use
+    // insertion sort for them.
+    inline void sort_colors(Label *begin, Label *end) {
+        if( end - begin > 16 ) {
+            std::sort(begin, end);
+        } else {
+            for( Label *i = begin + 1; i < end; ++i ) {
+                Label c = *i;
+                Label *j = i;
+                for( ; (j > begin) && (*(j - 1) > c); --j )
+                    *j = *(j - 1);
+                *j = c;
+            }
+        }
+    }
+
+    // Signature of node "v" in "coloring": color of "v" followed, for each
+    // non-empty (direction, label) group, by the direction, the label, the
+    // size of the group and the sorted colors of the neighbors in the group.
+    // With "Undirected", inbound groups are left out: they repeat the
+    // outbound ones, so the partition is the same (but signatures are not
+    // comparable with those of directed views).
+    template<bool Undirected = false>
+    inline void get_signature(const GraphLibrary::CSRGraph &csr, const Label *coloring, Node v, Labels &signature) {
+        signature.clear();
+        signature.push_back(coloring[v]);
+        for( uint direction = 0; direction < (Undirected ? 1U : 2U); ++direction ) {
+            const GraphLibrary::CSRGraph::Arc *begin = direction == 0 ? csr.outbound_begin(v) : csr.inbound_begin(v);
+            const GraphLibrary::CSRGraph::Arc *end = direction == 0 ? csr.outbound_end(v) : csr.inbound_end(v);
+            while( begin != end ) {
+                uint label = begin->label;
+                size_t pos = signature.size();
+                signature.push_back(direction);
+                signature.push_back(label);
+                signature.push_back(0);
+                for( ; (begin != end) && (begin->label == label); ++begin )
+                    signature.push_back(coloring[begin->node]);
+                signature[pos + 2] = signature.size() - pos - 3;
+                sort_colors(signature.data() + pos + 3, signature.data() + signature.size());
+            }
+        }
+    }
+
+    class SignatureTable {
+      public:
+        // Ctors/dtor.
+        SignatureTable() : m_slots(16, 0) { }
+        ~SignatureTable() { }
+
+        // Hash of signature.
+        static size_t hash(const Label *signature, size_t length) {
+            size_t h = 0x9e3779b97f4a7c15UL ^ length;
+            for( size_t i = 0; i < length; ++i ) {
+                h ^= signature[i] + 0x9e3779b97f4a7c15UL + (h << 6) + (h >> 2);
+                h *= 0xff51afd7ed558ccdUL;
+            }
+            return h ^ (h >> 33);
+        }
+
+        // Return id of signature, inserting it if new.
+        Label intern(const Label *signature, size_t length) {
+            return intern(signature, length, hash(signature, length));
+        }
+        Label intern(const Label *signature, size_t length, size_t h) {
+            size_t mask = m_slots.size() - 1;
+            for( size_t i = h & mask; true; i = (i + 1) & mask ) {
+                uint slot = m_slots[i];
+                if( slot == 0 ) {
+                    m_entries.push_back(Entry{ m_arena.size(), length, h });
+                    m_arena.insert(m_arena.end(), signature, signature + length);
+                    m_slots[i] = m_entries.size();
+                    if( 2 * m_entries.size() > m_slots.size() )
+                        rehash(2 * m_slots.size());
+                    return m_entries.size();
+                } else {
+                    const Entry &entry = m_entries[slot - 1];
+                    if( (entry.hash == h) && (entry.length == length) &&
+                        std::equal(signature, signature + length, m_arena.begin() + entry.offset) ) {
+                        return slot;
+                    }
+                }
+            }
+        }
+
+        // Number of interned signatures.
+        size_t size() const {
+            return m_entries.size();
+        }
+
+        // Get interned signature with given id.
+        const Label* get_signature(Label id) const {
+            return m_arena.data() + m_entries[id - 1].offset;
+        }
+        size_t get_length(Label id) const {
+            return m_entries[id - 1].length;
+        }
+        size_t get_hash(Label id) const {
+            return m_entries[id - 1].hash;
+        }
+
+        // Remove all signatures. Memory is kept for reuse.
+        void clear() {
+            m_arena.clear();
+            m_entries.clear();
+            std::fill(m_slots.begin(), m_slots.end(), 0);
+        }
+
+      private:
+        struct Entry {
+            size_t offset;
+            size_t length;
+            size_t hash;
+        };
+
+        Labels m_arena;
+        std::vector<Entry> m_entries;
+        std::vector<uint> m_slots; // 0 is empty, otherwise entry index + 1
+
+        void rehash(size_t num_slots) {
+            m_slots.assign(num_slots, 0);
+            size_t mask = num_slots - 1;
+            for( size_t k = 0; k < m_entries.size(); ++k ) {
+                size_t i = m_entries[k].hash & mask;
+                while( m_slots[i] != 0 ) i = (i + 1) & mask;
+                m_slots[i] = k + 1;
+            }
+        }
+    };
+}
+
+#endif // SIGNATURE_TABLE_H
+
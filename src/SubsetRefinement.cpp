@@ -0,0 +1,107 @@
+/**********************************************************************
+ * Stable colorings of a graph restricted to many subsets of edge labels.
+ *********************************************************************/
+
+#include <algorithm>
+#include <cstdint>
+#include "SubsetRefinement.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    namespace {
+        // Set of labels as bit mask.
+        typedef vector<uint64_t> LabelSet;
+
+        inline bool is_subset(const LabelSet &a, const LabelSet &b) {
+            for( size_t i = 0; i < a.size(); ++i ) {
+                if( (a[i] & ~b[i]) != 0 ) return false;
+            }
+            return true;
+        }
+
+        // Stable coloring kept as seed.
+        struct Seed {
+            int index;
+            LabelSet labels;
+            size_t num_colors;
+            vector<uint> coloring;
+        };
+    }
+
+    void SubsetRefinement::compute(const vector<vector<uint> > &subsets, vector<Result> &results, const Options &options) const {
+        uint num_edge_labels = m_csr.get_num_edge_labels();
+        Node num_nodes = m_csr.get_num_nodes();
+        size_t num_words = (num_edge_labels + 63) / 64;
+        Options refinement = options;
+        refinement.exact_colors = true;
+        refinement.max_rounds = 0;
+        refinement.time_budget = 0;
+        refinement.round_stats = nullptr;
+        refinement.stable = nullptr;
+
+        // Label sets, processed by increasing size (then in input order).
+        vector<LabelSet> label_sets(subsets.size(), LabelSet(num_words, 0));
+        vector<size_t> sizes(subsets.size(), 0);
+        for( size_t i = 0; i < subsets.size(); ++i ) {
+            for( uint label : subsets[i] ) {
+                if( (label < num_edge_labels) && ((label_sets[i][label / 64] & (uint64_t(1) << (label % 64))) == 0) ) {
+                    label_sets[i][label / 64] |= uint64_t(1) << (label % 64);
+                    ++sizes[i];
+                }
+            }
+        }
+        vector<int> order(subsets.size());
+        for( size_t i = 0; i < order.size(); ++i )
+            order[i] = i;
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return sizes[a] < sizes[b]; });
+
+        results.assign(subsets.size(), Result{ 0, 0, -1 });
+        vector<Seed> seeds;
+        size_t seed_bytes = sizeof(uint) * size_t(num_nodes);
+        size_t max_seeds = max<size_t>(1, m_max_memory / max<size_t>(1, seed_bytes));
+        Labels initial_coloring(m_csr.get_node_labels());
+        vector<bool> keep_label(num_edge_labels);
+        for( int i : order ) {
+            const LabelSet &labels = label_sets[i];
+            Result &result = results[i];
+
+            // Same set, or else finest seed among subsets.
+            const Seed *seed = nullptr;
+            for( const Seed &candidate : seeds ) {
+                if( candidate.labels == labels ) {
+                    seed = &candidate;
+                    break;
+                } else if( ((seed == nullptr) || (candidate.num_colors > seed->num_colors)) && is_subset(candidate.labels, labels) ) {
+                    seed = &candidate;
+                }
+            }
+            if( seed != nullptr ) {
+                result.seed = seed->index;
+                if( (seed->labels == labels) || (seed->num_colors == num_nodes) ) {
+                    result.num_colors = seed->num_colors;
+                    continue;
+                }
+            }
+
+            // Refine seed over the edges with labels in the set.
+            for( uint label = 0; label < num_edge_labels; ++label )
+                keep_label[label] = (labels[label / 64] & (uint64_t(1) << (label % 64))) != 0;
+            GraphLibrary::CSRGraph filtered = m_csr.filter_labels(keep_label);
+            Labels node_labels = seed == nullptr ? initial_coloring : Labels(seed->coloring.begin(), seed->coloring.end());
+            Coloring coloring;
+            ColorRefinement cr(filtered);
+            result.num_iterations = cr.compute_stable_coloring(coloring, node_labels, refinement);
+            result.num_colors = coloring.get_num_colors();
+
+            // Keep coloring as seed, replacing the coarsest seed if full.
+            Seed new_seed{ i, labels, result.num_colors, vector<uint>(coloring.node_to_color.begin(), coloring.node_to_color.end()) };
+            if( seeds.size() < max_seeds ) {
+                seeds.push_back(std::move(new_seed));
+            } else {
+                auto coarsest = min_element(seeds.begin(), seeds.end(), [](const Seed &a, const Seed &b) { return a.num_colors < b.num_colors; });
+                if( coarsest->num_colors < new_seed.num_colors ) *coarsest = std::move(new_seed);
+            }
+        }
+    }
+}
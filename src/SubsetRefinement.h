@@ -0,0 +1,58 @@
+/**********************************************************************
+ * Stable colorings of a graph restricted to many subsets of edge labels.
+ *
+ * The stable coloring for a set of labels T refines the stable coloring
+ * for any subset S of T: a coloring that is stable for the edges with
+ * labels in T is also stable for those with labels in S, and the stable
+ * coloring is the coarsest stable one refining the initial coloring. So
+ * refining the stable coloring for S over the edges of T gives the same
+ * partition as refining the initial coloring, usually in fewer rounds.
+ * Subsets are processed by increasing size, and each one is seeded with
+ * the finest stable coloring computed so far for one of its subsets
+ * (repeated subsets, and supersets of subsets with a discrete coloring,
+ * need no refinement at all).
+ *********************************************************************/
+
+#ifndef SUBSET_REFINEMENT_H
+#define SUBSET_REFINEMENT_H
+
+#include <vector>
+#include "CSRGraph.h"
+#include "ColorRefinement.h"
+#include "Graph.h"
+
+namespace ColorRefinement {
+    class SubsetRefinement {
+      public:
+        // Result for a subset: number of colors of the stable coloring,
+        // rounds of refinement done, and index of the subset whose coloring
+        // was the seed (-1 if none).
+        struct Result {
+            size_t num_colors;
+            int num_iterations;
+            int seed;
+        };
+
+        // Ctors/dtor. Edge labels of "csr" are label indices, as given by
+        // make_csr_graph() of clingo files. Colorings kept as seeds take at
+        // most "max_memory" bytes.
+        explicit SubsetRefinement(const GraphLibrary::CSRGraph &csr, size_t max_memory = size_t(1) << 30)
+          : m_csr(csr),
+            m_max_memory(max_memory) {
+        }
+        ~SubsetRefinement() { }
+
+        // Compute the number of colors of the stable coloring for each subset
+        // of label indices (labels without edges have no effect). Colors are
+        // exact; limits on rounds and time of "options" are ignored since
+        // seeds must be stable.
+        void compute(const std::vector<std::vector<uint> > &subsets, std::vector<Result> &results, const Options &options = Options()) const;
+
+      private:
+        const GraphLibrary::CSRGraph &m_csr;
+        const size_t m_max_memory;
+    };
+}
+
+#endif // SUBSET_REFINEMENT_H
+
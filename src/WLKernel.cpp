@@ -0,0 +1,176 @@
+/**********************************************************************
+ * Weisfeiler-Leman subtree kernel over a database of graphs.
+ *********************************************************************/
+
+#include <algorithm>
+#include "WLKernel.h"
+#include "WorkStealingPool.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    void WLKernel::compute_features(int num_rounds, uint num_threads) {
+        size_t num_graphs = m_graphs.size();
+        num_threads = max(1U, min<uint>(num_threads, num_graphs));
+
+        // Colors of nodes of each graph in last round, and features of each
+        // graph as (feature, count) pairs in increasing order of feature.
+        vector<Labels> colors(num_graphs), old_colors(num_graphs);
+        vector<vector<pair<uint, uint> > > features(num_graphs);
+        for( size_t g = 0; g < num_graphs; ++g )
+            colors[g].resize(m_graphs[g]->get_num_nodes());
+
+        // Features of round r are ids of signatures of round r, shifted by
+        // the number of features of previous rounds. Each chunk of graphs is
+        // interned in a local table, and local tables are merged in chunk
+        // order, which gives ids in order of first occurrence.
+        m_round_offsets.assign(1, 1);
+        vector<SignatureTable> local_tables(num_threads);
+        vector<Labels> local_to_global(num_threads);
+        SignatureTable table;
+        for( int r = 0; r <= num_rounds; ++r ) {
+            old_colors.swap(colors);
+            GraphLibrary::parallel_for(num_graphs, num_threads, [&](uint i, size_t begin, size_t end) {
+                Labels signature;
+                for( size_t g = begin; g < end; ++g ) {
+                    const GraphLibrary::CSRGraph &graph = *m_graphs[g];
+                    colors[g].resize(graph.get_num_nodes());
+                    for( Node v = 0; v < graph.get_num_nodes(); ++v ) {
+                        // Round 0 signature is the node label.
+                        if( r == 0 )
+                            signature.assign(1, graph.get_node_labels()[v]);
+                        else
+                            get_signature(graph, old_colors[g].data(), v, signature);
+                        colors[g][v] = local_tables[i].intern(signature.data(), signature.size());
+                    }
+                }
+            });
+
+            table.clear();
+            for( uint i = 0; i < num_threads; ++i ) {
+                const SignatureTable &local = local_tables[i];
+                local_to_global[i].resize(1 + local.size());
+                for( Label id = 1; id <= local.size(); ++id )
+                    local_to_global[i][id] = m_round_offsets.back() - 1 + table.intern(local.get_signature(id), local.get_length(id), local.get_hash(id));
+                local_tables[i].clear();
+            }
+
+            // Translate colors and append histograms of round.
+            GraphLibrary::parallel_for(num_graphs, num_threads, [&](uint i, size_t begin, size_t end) {
+                Labels sorted;
+                for( size_t g = begin; g < end; ++g ) {
+                    for( Label &color : colors[g] )
+                        color = local_to_global[i][color];
+                    sorted = colors[g];
+                    sort(sorted.begin(), sorted.end());
+                    for( size_t j = 0; j < sorted.size(); ) {
+                        size_t k = j;
+                        while( (k < sorted.size()) && (sorted[k] == sorted[j]) ) ++k;
+                        features[g].emplace_back(sorted[j], k - j);
+                        j = k;
+                    }
+                }
+            });
+            m_round_offsets.push_back(m_round_offsets.back() + table.size());
+        }
+
+        // Store features in CSR format.
+        m_offsets.assign(1, 0);
+        m_feature_ids.clear();
+        m_feature_counts.clear();
+        for( size_t g = 0; g < num_graphs; ++g ) {
+            for( const pair<uint, uint> &feature : features[g] ) {
+                m_feature_ids.push_back(feature.first);
+                m_feature_counts.push_back(feature.second);
+            }
+            m_offsets.push_back(m_feature_ids.size());
+            vector<pair<uint, uint> >().swap(features[g]);
+        }
+    }
+
+    ulong WLKernel::kernel(size_t i, size_t j) const {
+        ulong value = 0;
+        size_t a = m_offsets[i], b = m_offsets[j];
+        while( (a < m_offsets[i + 1]) && (b < m_offsets[j + 1]) ) {
+            if( m_feature_ids[a] < m_feature_ids[b] ) {
+                ++a;
+            } else if( m_feature_ids[b] < m_feature_ids[a] ) {
+                ++b;
+            } else {
+                value += ulong(m_feature_counts[a++]) * m_feature_counts[b++];
+            }
+        }
+        return value;
+    }
+
+    void WLKernel::write_features(GraphLibrary::BufferedWriter &writer) const {
+        for( size_t r = 0; r + 1 < m_round_offsets.size(); ++r ) {
+            writer.put("# round ");
+            writer.put_uint(r);
+            writer.put(": features ");
+            writer.put_uint(m_round_offsets[r]);
+            writer.put('-');
+            writer.put_uint(m_round_offsets[r + 1] - 1);
+            writer.put('\n');
+        }
+        for( size_t g = 0; g < get_num_graphs(); ++g ) {
+            writer.put_uint(g);
+            for( size_t k = m_offsets[g]; k < m_offsets[g + 1]; ++k ) {
+                writer.put(' ');
+                writer.put_uint(m_feature_ids[k]);
+                writer.put(':');
+                writer.put_uint(m_feature_counts[k]);
+            }
+            writer.put('\n');
+        }
+    }
+
+    void WLKernel::write_gram_matrix(GraphLibrary::BufferedWriter &writer, uint num_threads) const {
+        size_t num_graphs = get_num_graphs();
+        size_t num_features = get_num_features();
+        num_threads = max(1U, min<uint>(num_threads, num_graphs));
+
+        // Inverted index: graphs having each feature, with counts.
+        vector<size_t> posting_offsets(num_features + 2, 0);
+        for( uint feature : m_feature_ids )
+            ++posting_offsets[feature + 1];
+        for( size_t f = 1; f < posting_offsets.size(); ++f )
+            posting_offsets[f] += posting_offsets[f - 1];
+        vector<pair<uint, uint> > postings(m_feature_ids.size());
+        {
+            vector<size_t> next(posting_offsets.begin(), posting_offsets.end() - 1);
+            for( size_t g = 0; g < num_graphs; ++g ) {
+                for( size_t k = m_offsets[g]; k < m_offsets[g + 1]; ++k )
+                    postings[next[m_feature_ids[k]]++] = make_pair(g, m_feature_counts[k]);
+            }
+        }
+
+        // Row i is accumulated over the postings of the features of graph
+        // i. Blocks of rows are split among threads, then written in order.
+        size_t block = 16 * num_threads;
+        vector<ulong> rows(min(block, num_graphs) * num_graphs);
+        for( size_t first = 0; first < num_graphs; first += block ) {
+            size_t last = min(num_graphs, first + block);
+            GraphLibrary::parallel_for(last - first, num_threads, [&](uint, size_t begin, size_t end) {
+                for( size_t i = first + begin; i < first + end; ++i ) {
+                    ulong *row = rows.data() + (i - first) * num_graphs;
+                    fill(row, row + num_graphs, 0);
+                    for( size_t k = m_offsets[i]; k < m_offsets[i + 1]; ++k ) {
+                        ulong count = m_feature_counts[k];
+                        uint feature = m_feature_ids[k];
+                        for( size_t p = posting_offsets[feature]; p < posting_offsets[feature + 1]; ++p )
+                            row[postings[p].first] += count * postings[p].second;
+                    }
+                }
+            });
+            for( size_t i = first; i < last; ++i ) {
+                const ulong *row = rows.data() + (i - first) * num_graphs;
+                for( size_t j = 0; j < num_graphs; ++j ) {
+                    if( j > 0 ) writer.put(' ');
+                    writer.put_uint(row[j]);
+                }
+                writer.put('\n');
+            }
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/**********************************************************************
+ * Weisfeiler-Leman subtree kernel over a database of graphs.
+ *
+ * Runs h rounds of color refinement on every graph with one dictionary
+ * shared by all graphs, so that a color means the same subtree pattern in
+ * every graph. The feature vector of a graph counts the nodes of each
+ * color in rounds 0, ..., h, and the kernel of two graphs is the dot
+ * product of their feature vectors (Shervashidze et al. Weisfeiler-Lehman
+ * Graph Kernels. JMLR 2011).
+ *
+ * Features are numbered { 1, 2, ... } by round, and within a round in
+ * order of first occurrence (graph by graph, node by node). The graphs of
+ * a round are split among threads that intern signatures in local tables,
+ * merged in graph order, so features do not depend on the number of
+ * threads. Edge labels and node labels must agree among graphs (e.g.,
+ * label indices as given by make_csr_graph() of LPReader).
+ *********************************************************************/
+
+#ifndef WL_KERNEL_H
+#define WL_KERNEL_H
+
+#include <vector>
+#include "BufferedWriter.h"
+#include "CSRGraph.h"
+#include "SignatureTable.h"
+
+namespace ColorRefinement {
+    class WLKernel {
+      public:
+        // Ctors/dtor.
+        explicit WLKernel(const std::vector<const GraphLibrary::CSRGraph*> &graphs) : m_graphs(graphs) { }
+        ~WLKernel() { }
+
+        // Compute features of all graphs for rounds 0, ..., num_rounds.
+        void compute_features(int num_rounds, uint num_threads = 1);
+
+        // Features as a sparse matrix in CSR format: the features of graph i
+        // are feature_ids[offsets[i] ... offsets[i + 1] - 1] (increasing) with
+        // counts in feature_counts. Features of round r are in
+        // [round_offsets[r], round_offsets[r + 1]).
+        size_t get_num_graphs() const {
+            return m_graphs.size();
+        }
+        size_t get_num_features() const {
+            return m_round_offsets.empty() ? 0 : m_round_offsets.back() - 1;
+        }
+        const std::vector<size_t>& get_offsets() const {
+            return m_offsets;
+        }
+        const std::vector<uint>& get_feature_ids() const {
+            return m_feature_ids;
+        }
+        const std::vector<uint>& get_feature_counts() const {
+            return m_feature_counts;
+        }
+        const std::vector<uint>& get_round_offsets() const {
+            return m_round_offsets;
+        }
+
+        // Kernel of graphs i and j (dot product of their features).
+        ulong kernel(size_t i, size_t j) const;
+
+        // Write features in svmlight format: a line "i f:c f:c ..." for each
+        // graph i, preceded by comment lines with the features of each round.
+        void write_features(GraphLibrary::BufferedWriter &writer) const;
+
+        // Write Gram matrix, one line per graph. Rows are computed by threads
+        // in blocks, using an inverted index of features, and written in order.
+        void write_gram_matrix(GraphLibrary::BufferedWriter &writer, uint num_threads = 1) const;
+
+      private:
+        const std::vector<const GraphLibrary::CSRGraph*> m_graphs;
+
+        std::vector<size_t> m_offsets;
+        std::vector<uint> m_feature_ids;
+        std::vector<uint> m_feature_counts;
+        std::vector<uint> m_round_offsets;
+    };
+}
+
+#endif // WL_KERNEL_H
+
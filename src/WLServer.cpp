@@ -0,0 +1,390 @@
+/**********************************************************************
+ * Long-running server of stable colorings with a result cache.
+ *********************************************************************/
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "BinaryGraph.h"
+#include "CSRGraph.h"
+#include "LPReader.h"
+#include "WLServer.h"
+
+using namespace std;
+
+namespace ColorRefinement {
+    namespace {
+        // Non-cryptographic 128-bit hash of a stream of bytes.
+        class Hasher {
+          public:
+            Hasher() : m_a(0x9e3779b97f4a7c15UL), m_b(0xc2b2ae3d27d4eb4fUL), m_size(0) { }
+
+            void update(const void *data, size_t size) {
+                const char *p = static_cast<const char*>(data);
+                for( ; size >= 8; p += 8, size -= 8 ) {
+                    uint64_t word;
+                    memcpy(&word, p, 8);
+                    mix(word);
+                }
+                if( size > 0 ) {
+                    uint64_t word = 0;
+                    memcpy(&word, p, size);
+                    mix(word ^ (uint64_t(size) << 56));
+                }
+            }
+            void update(uint64_t value) {
+                mix(value);
+            }
+            void update(const string &str) {
+                update(str.size());
+                update(str.data(), str.size());
+            }
+
+            pair<uint64_t, uint64_t> get() const {
+                uint64_t a = finalize(m_a ^ m_size), b = finalize(m_b + m_size);
+                return make_pair(a, finalize(b ^ a));
+            }
+
+          private:
+            uint64_t m_a;
+            uint64_t m_b;
+            uint64_t m_size;
+
+            void mix(uint64_t word) {
+                m_a = (m_a ^ word) * 0xff51afd7ed558ccdUL;
+                m_a ^= m_a >> 32;
+                m_b = ((m_b << 31) | (m_b >> 33)) + (word ^ 0x165667b19e3779f9UL);
+                m_b *= 0xc4ceb9fe1a85ec53UL;
+                ++m_size;
+            }
+            static uint64_t finalize(uint64_t h) {
+                h ^= h >> 33;
+                h *= 0xff51afd7ed558ccdUL;
+                h ^= h >> 33;
+                h *= 0xc4ceb9fe1a85ec53UL;
+                return h ^ (h >> 33);
+            }
+        };
+
+        // Buffered reader of lines and blocks from a file descriptor.
+        class Reader {
+          public:
+            explicit Reader(int fd) : m_fd(fd), m_pos(0) { }
+
+            bool read_line(string &line) {
+                for( ;; ) {
+                    size_t eol = m_buffer.find('\n', m_pos);
+                    if( eol != string::npos ) {
+                        line.assign(m_buffer, m_pos, eol - m_pos);
+                        m_pos = eol + 1;
+                        return true;
+                    }
+                    if( m_buffer.size() - m_pos > 4096 ) return false;
+                    if( !fill() ) return false;
+                }
+            }
+
+            // Read "size" bytes into "data" in bounded chunks, so that memory
+            // grows with the bytes actually received. Bytes consumed are
+            // counted in "num_read" (also when an allocation fails).
+            bool read(size_t size, string &data, size_t &num_read) {
+                data.clear();
+                num_read = 0;
+                while( num_read < size ) {
+                    if( (m_pos == m_buffer.size()) && !fill() ) return false;
+                    size_t n = min(size - num_read, m_buffer.size() - m_pos);
+                    data.append(m_buffer, m_pos, n);
+                    m_pos += n;
+                    num_read += n;
+                }
+                return true;
+            }
+
+            // Discard "size" bytes.
+            bool skip(size_t size) {
+                while( size > 0 ) {
+                    if( (m_pos == m_buffer.size()) && !fill() ) return false;
+                    size_t n = min(size, m_buffer.size() - m_pos);
+                    m_pos += n;
+                    size -= n;
+                }
+                return true;
+            }
+
+          private:
+            const int m_fd;
+            string m_buffer;
+            size_t m_pos;
+
+            bool fill() {
+                m_buffer.erase(0, m_pos);
+                m_pos = 0;
+                char chunk[1 << 16];
+                for( ;; ) {
+                    ssize_t n = ::read(m_fd, chunk, sizeof(chunk));
+                    if( (n < 0) && (errno == EINTR) ) continue;
+                    if( n <= 0 ) return false;
+                    m_buffer.append(chunk, n);
+                    return true;
+                }
+            }
+        };
+
+        bool write_all(int fd, const char *data, size_t size) {
+            while( size > 0 ) {
+                ssize_t n = write(fd, data, size);
+                if( (n < 0) && (errno == EINTR) ) continue;
+                if( n <= 0 ) return false;
+                data += n;
+                size -= n;
+            }
+            return true;
+        }
+    }
+
+    bool WLServer::serve(int in_fd, int out_fd) {
+        Reader reader(in_fd);
+        for( string line; reader.read_line(line); ) {
+            vector<string> fields;
+            istringstream iss(line);
+            for( string field; iss >> field; )
+                fields.push_back(field);
+            if( fields.empty() ) continue;
+
+            string answer;
+            ResultPtr result;
+            if( (fields[0] == "quit") && (fields.size() == 1) ) {
+                return true;
+            } else if( (fields[0] == "stats") && (fields.size() == 1) ) {
+                answer = "stats " + to_string(m_num_requests) + " " + to_string(m_num_memory_hits) + " " + to_string(m_num_disk_hits) +
+                         " " + to_string(m_cache.size()) + " " + to_string(m_cache_bytes) + "\n";
+            } else if( (fields[0] == "color") && (fields.size() >= 3) ) {
+                // The payload cannot be skipped without its size.
+                if( (fields[2].size() > 15) || (fields[2].find_first_not_of("0123456789") != string::npos) ) {
+                    answer = "error malformed size '" + fields[2] + "'\n";
+                    write_all(out_fd, answer.data(), answer.size());
+                    return false;
+                }
+                size_t size = stoull(fields[2]);
+                if( size > m_options.max_payload ) {
+                    answer = "error payload too large (" + fields[2] + " bytes, at most " + to_string(m_options.max_payload) + ")\n";
+                    if( !write_all(out_fd, answer.data(), answer.size()) || !reader.skip(size) ) return false;
+                    continue;
+                }
+
+                // Allocation failures only fail the request.
+                size_t num_read = 0;
+                try {
+                    shared_ptr<string> payload = make_shared<string>();
+                    if( !reader.read(size, *payload, num_read) ) return false;
+                    answer = color(fields, payload, result);
+                } catch( const bad_alloc& ) {
+                    result = nullptr;
+                    answer = "error out of memory\n";
+                    if( !reader.skip(size - num_read) ) return false;
+                }
+            } else {
+                answer = "error unrecognized request '" + line + "'\n";
+            }
+            if( !write_all(out_fd, answer.data(), answer.size()) ) return false;
+            if( (result != nullptr) && !write_all(out_fd, result->coloring.data(), result->coloring.size()) ) return false;
+        }
+        return false;
+    }
+
+    bool WLServer::serve_socket(const string &path, string &error) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if( path.size() >= sizeof(address.sun_path) ) {
+            error = "socket path '" + path + "' is too long";
+            return false;
+        }
+        strcpy(address.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if( fd == -1 ) {
+            error = "creating socket";
+            return false;
+        }
+        if( (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) || (listen(fd, 16) == -1) ) {
+            close(fd);
+            error = "binding socket '" + path + "': " + strerror(errno);
+            return false;
+        }
+
+        // Clients that hang up must not kill the server.
+        signal(SIGPIPE, SIG_IGN);
+        for( bool quit = false; !quit; ) {
+            int connection = accept(fd, nullptr, nullptr);
+            if( connection == -1 ) {
+                if( errno == EINTR ) continue;
+                error = "accepting connection";
+                close(fd);
+                unlink(path.c_str());
+                return false;
+            }
+            quit = serve(connection, connection);
+            close(connection);
+        }
+        close(fd);
+        unlink(path.c_str());
+        return true;
+    }
+
+    string WLServer::color(const vector<string> &fields, shared_ptr<const string> payload, ResultPtr &result) {
+        ++m_num_requests;
+        auto ok = [&](const string &source) {
+            return "ok " + to_string(result->num_iterations) + " " + to_string(result->num_colors) + " " + source + " " + to_string(result->coloring.size()) + "\n";
+        };
+        const string &format = fields[1];
+        if( (format != "lp") && (format != "wlg") ) return "error unrecognized format '" + format + "'\n";
+
+        Request request;
+        request.refinement = m_options.refinement;
+        request.uniform_initial_coloring = m_options.uniform_initial_coloring;
+        request.use_chosen_labels = m_options.use_chosen_labels;
+        request.output_format = m_options.output_format;
+        for( size_t i = 3; i < fields.size(); ++i ) {
+            const string &option = fields[i];
+            if( option == "uniform-initial-coloring" ) {
+                request.uniform_initial_coloring = true;
+            } else if( option == "disable-chosen-labels" ) {
+                request.use_chosen_labels = false;
+            } else if( option == "exact-colors" ) {
+                request.refinement.exact_colors = true;
+            } else if( option == "normalize-colors" ) {
+                request.refinement.normalize_colors = true;
+            } else if( option == "sparse-labels" ) {
+                request.refinement.sparse_labels = true;
+            } else if( (option.compare(0, 14, "output-format=") != 0) ||
+                       !ColoringWriter::parse_format(option.substr(14), request.output_format) ) {
+                return "error unrecognized option '" + option + "'\n";
+            }
+        }
+
+        // Results within a time budget may differ among runs.
+        bool cacheable = request.refinement.time_budget == 0;
+        Hasher options_hasher;
+        options_hasher.update(request.refinement.exact_colors);
+        options_hasher.update(request.refinement.normalize_colors);
+        options_hasher.update(request.refinement.sparse_labels);
+        options_hasher.update(request.refinement.max_rounds);
+        options_hasher.update(uint64_t(request.output_format));
+
+        // Exact repeat.
+        Hasher raw_hasher = options_hasher;
+        raw_hasher.update(string("raw ") + format);
+        raw_hasher.update(request.uniform_initial_coloring);
+        raw_hasher.update(request.use_chosen_labels);
+        raw_hasher.update(*payload);
+        Key raw_key = raw_hasher.get();
+        string source;
+        if( cacheable && ((result = lookup(raw_key, source)) != nullptr) ) return ok(source);
+
+        // Normalized graph.
+        string error;
+        unique_ptr<GraphLibrary::CSRGraph> csr;
+        if( format == "lp" ) {
+            GraphLibrary::LPGraph lp_graph;
+            if( !GraphLibrary::read_lp_data(payload->data(), payload->size(), lp_graph, error) ) return "error " + error + "\n";
+            csr.reset(new GraphLibrary::CSRGraph(GraphLibrary::make_remapped_csr_graph(GraphLibrary::make_graph(lp_graph, request.uniform_initial_coloring, request.use_chosen_labels))));
+        } else {
+            GraphLibrary::BinaryGraph binary_graph;
+            if( !GraphLibrary::read_binary_data(payload, binary_graph, error) ) return "error " + error + "\n";
+            csr.reset(new GraphLibrary::CSRGraph(GraphLibrary::make_csr_graph(binary_graph, request.uniform_initial_coloring, request.use_chosen_labels)));
+        }
+        Hasher graph_hasher = options_hasher;
+        graph_hasher.update(string("csr"));
+        graph_hasher.update(csr->get_num_nodes());
+        graph_hasher.update(csr->get_num_edges());
+        graph_hasher.update(csr->get_num_edge_labels());
+        graph_hasher.update(csr->directed());
+        graph_hasher.update(csr->get_node_labels().data(), sizeof(Label) * csr->get_num_nodes());
+        graph_hasher.update(csr->get_outbound_offsets(), sizeof(Edge) * (1 + csr->get_num_nodes()));
+        graph_hasher.update(csr->get_outbound_arcs(), sizeof(GraphLibrary::CSRGraph::Arc) * csr->get_num_edges());
+        Key graph_key = graph_hasher.get();
+        if( cacheable && ((result = lookup(graph_key, source)) != nullptr) ) {
+            insert(raw_key, result, true);
+            return ok(source);
+        }
+
+        // Compute.
+        shared_ptr<Result> computed = make_shared<Result>();
+        Coloring coloring;
+        ColorRefinement cr(*csr);
+        computed->num_iterations = cr.compute_stable_coloring(coloring, csr->get_node_labels(), request.refinement);
+        computed->num_colors = coloring.get_num_colors();
+        {
+            ColoringWriter writer(&computed->coloring);
+            writer.write(coloring, request.output_format);
+            writer.flush();
+        }
+        result = computed;
+        if( cacheable ) {
+            insert(graph_key, result, true);
+            insert(raw_key, result, true);
+        }
+        return ok("computed");
+    }
+
+    WLServer::ResultPtr WLServer::lookup(const Key &key, string &source) {
+        auto it = m_cache.find(key);
+        if( it != m_cache.end() ) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            ++m_num_memory_hits;
+            source = "memory";
+            return it->second->second;
+        }
+        if( m_options.cache_dir.empty() ) return nullptr;
+
+        // Cached file: "ITERATIONS COLORS\n" followed by coloring.
+        ifstream ifs(get_path(key), ifstream::in | ifstream::binary);
+        if( !ifs.is_open() ) return nullptr;
+        shared_ptr<Result> result = make_shared<Result>();
+        string header;
+        if( !getline(ifs, header) || (sscanf(header.c_str(), "%d %zu", &result->num_iterations, &result->num_colors) != 2) ) return nullptr;
+        result->coloring.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+        ++m_num_disk_hits;
+        source = "disk";
+        insert(key, result, false);
+        return result;
+    }
+
+    void WLServer::insert(const Key &key, ResultPtr result, bool to_disk) {
+        if( m_cache.find(key) == m_cache.end() ) {
+            m_lru.emplace_front(key, result);
+            m_cache.emplace(key, m_lru.begin());
+            m_cache_bytes += result->coloring.size();
+            while( (m_cache_bytes > m_options.cache_size) && !m_lru.empty() ) {
+                m_cache_bytes -= m_lru.back().second->coloring.size();
+                m_cache.erase(m_lru.back().first);
+                m_lru.pop_back();
+            }
+        }
+
+        // Written to temporary file and renamed, so readers never see partial
+        // files.
+        if( to_disk && !m_options.cache_dir.empty() ) {
+            string path = get_path(key);
+            string tmp_path = path + ".tmp";
+            ofstream ofs(tmp_path, ofstream::out | ofstream::binary);
+            ofs << result->num_iterations << " " << result->num_colors << "\n";
+            ofs.write(result->coloring.data(), result->coloring.size());
+            ofs.close();
+            if( ofs.fail() || (rename(tmp_path.c_str(), path.c_str()) != 0) )
+                remove(tmp_path.c_str());
+        }
+    }
+
+    string WLServer::get_path(const Key &key) const {
+        char name[40];
+        snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)key.first, (unsigned long long)key.second);
+        return m_options.cache_dir + "/" + name + ".wlc";
+    }
+}
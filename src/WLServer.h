@@ -0,0 +1,138 @@
+/**********************************************************************
+ * Long-running server of stable colorings with a result cache.
+ *
+ * Requests are read from a pair of file descriptors (stdin/stdout) or from
+ * the connections to a Unix domain socket. Each request is a header line
+ * followed by a payload:
+ *
+ *   color FORMAT NUM_BYTES [OPTION ...]   graph of NUM_BYTES bytes follows;
+ *                                         FORMAT is lp (clingo) or wlg
+ *                                         (binary graph); OPTIONs are
+ *                                         uniform-initial-coloring,
+ *                                         disable-chosen-labels, exact-colors,
+ *                                         normalize-colors, sparse-labels and
+ *                                         output-format=text|asp|binary
+ *   stats                                 counters of the server
+ *   quit                                  stop the server
+ *
+ * and is answered with a header line, possibly followed by a payload:
+ *
+ *   ok ITERATIONS COLORS SOURCE NUM_BYTES coloring of NUM_BYTES bytes
+ *                                         follows; SOURCE is computed,
+ *                                         memory or disk (cache hits)
+ *   stats REQUESTS MEMORY_HITS DISK_HITS ENTRIES BYTES
+ *   error MESSAGE
+ *
+ * Payloads larger than a limit are skipped and answered with an error, as
+ * are requests that run out of memory; the server keeps running.
+ *
+ * Results are cached under two content hashes (128 bits): the hash of the
+ * payload and options, which answers exact repeats without parsing, and
+ * the hash of the normalized graph (the CSR view after chosen labels and
+ * initial coloring are applied) and the options of refinement and output,
+ * which also answers the same graph in another file or format. The memory
+ * cache is bounded and evicts least recently used results; with a cache
+ * directory, results are also stored on disk (one file per hash) and
+ * survive restarts.
+ *********************************************************************/
+
+#ifndef WL_SERVER_H
+#define WL_SERVER_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ColorRefinement.h"
+#include "ColoringWriter.h"
+
+namespace ColorRefinement {
+    class WLServer {
+      public:
+        // Default options of requests and limits of the cache.
+        struct Options {
+            ::ColorRefinement::Options refinement;
+            bool uniform_initial_coloring;
+            bool use_chosen_labels;
+            ColoringWriter::Format output_format;
+            // Bytes of colorings kept in memory.
+            size_t cache_size;
+            // Directory of cached results (none if empty).
+            std::string cache_dir;
+            // Largest payload of a request, in bytes.
+            size_t max_payload;
+
+            Options()
+              : uniform_initial_coloring(false),
+                use_chosen_labels(true),
+                output_format(ColoringWriter::Format::Text),
+                cache_size(size_t(256) << 20),
+                max_payload(size_t(1) << 30) {
+            }
+        };
+
+        // Ctors/dtor.
+        explicit WLServer(const Options &options) : m_options(options), m_cache_bytes(0), m_num_requests(0), m_num_memory_hits(0), m_num_disk_hits(0) { }
+        ~WLServer() { }
+
+        // Serve requests read from "in_fd" and answered on "out_fd" until end
+        // of input or quit. Returns true if quit was requested.
+        bool serve(int in_fd, int out_fd);
+
+        // Serve the connections to a Unix domain socket at "path", one at a
+        // time, until quit is requested. Returns false and sets "error" if the
+        // socket cannot be set up.
+        bool serve_socket(const std::string &path, std::string &error);
+
+      private:
+        // Content hash.
+        typedef std::pair<uint64_t, uint64_t> Key;
+        struct KeyHash {
+            size_t operator()(const Key &key) const {
+                return key.first ^ (key.second * 0x9e3779b97f4a7c15UL);
+            }
+        };
+
+        struct Result {
+            int num_iterations;
+            size_t num_colors;
+            std::string coloring;
+        };
+        typedef std::shared_ptr<const Result> ResultPtr;
+
+        // Options of a request.
+        struct Request {
+            ::ColorRefinement::Options refinement;
+            bool uniform_initial_coloring;
+            bool use_chosen_labels;
+            ColoringWriter::Format output_format;
+        };
+
+        const Options m_options;
+
+        // Memory cache in order of use (most recent first).
+        std::list<std::pair<Key, ResultPtr> > m_lru;
+        std::unordered_map<Key, std::list<std::pair<Key, ResultPtr> >::iterator, KeyHash> m_cache;
+        size_t m_cache_bytes;
+
+        size_t m_num_requests;
+        size_t m_num_memory_hits;
+        size_t m_num_disk_hits;
+
+        // Answer "color" request with given fields of header line and
+        // payload. Returns the header line of the answer, and sets "result"
+        // unless the answer is an error.
+        std::string color(const std::vector<std::string> &fields, std::shared_ptr<const std::string> payload, ResultPtr &result);
+
+        // Cached result with given key, looked up in memory and then on disk.
+        // Sets "source" to "memory" or "disk".
+        ResultPtr lookup(const Key &key, std::string &source);
+        void insert(const Key &key, ResultPtr result, bool to_disk);
+        std::string get_path(const Key &key) const;
+    };
+}
+
+#endif // WL_SERVER_H
+
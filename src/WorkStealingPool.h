@@ -0,0 +1,110 @@
+/**********************************************************************
+ * Work-stealing scheduler for batches of independent tasks.
+ *
+ * Tasks { 0, ..., #tasks - 1 } are dealt round-robin to the deques of the
+ * workers. A worker takes its tasks from the front of its deque, that is,
+ * roughly in input order, and when its deque is empty it steals from the
+ * back of the fullest deque of another worker. A few huge tasks then do
+ * not hold up the tiny ones dealt after them, while results finish close
+ * to input order (so they can be streamed in order with little buffering).
+ *********************************************************************/
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Graph.h"
+
+namespace GraphLibrary {
+    // Call f(i, begin, end) on contiguous chunks of [0, n), the i-th chunk
+    // in the i-th of "num_threads" threads. Returns when all chunks are done.
+    template<typename F>
+    void parallel_for(size_t n, uint num_threads, F f) {
+        if( num_threads <= 1 ) {
+            f(0U, size_t(0), n);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for( uint i = 0; i < num_threads; ++i )
+            threads.emplace_back(f, i, n * i / num_threads, n * (i + 1) / num_threads);
+        for( std::thread &t : threads )
+            t.join();
+    }
+
+    class WorkStealingPool {
+      public:
+        // Ctors/dtor.
+        explicit WorkStealingPool(uint num_threads) : m_num_threads(std::max(1U, num_threads)) { }
+        ~WorkStealingPool() { }
+
+        uint get_num_threads() const {
+            return m_num_threads;
+        }
+
+        // Call task(i) for each i in [0, num_tasks), with worker threads.
+        // Returns when all tasks are done.
+        template<typename F>
+        void run(size_t num_tasks, F task) {
+            std::vector<Deque> deques(m_num_threads);
+            for( size_t i = 0; i < num_tasks; ++i )
+                deques[i % m_num_threads].tasks.push_back(i);
+
+            std::vector<std::thread> threads;
+            for( uint w = 0; w < m_num_threads; ++w ) {
+                threads.emplace_back([&, w]() {
+                    size_t i;
+                    while( pop(deques[w], i) || steal(deques, w, i) )
+                        task(i);
+                });
+            }
+            for( std::thread &t : threads )
+                t.join();
+        }
+
+      private:
+        struct Deque {
+            std::mutex mutex;
+            std::deque<size_t> tasks;
+        };
+
+        uint m_num_threads;
+
+        static bool pop(Deque &deque, size_t &i) {
+            std::lock_guard<std::mutex> lock(deque.mutex);
+            if( deque.tasks.empty() ) return false;
+            i = deque.tasks.front();
+            deque.tasks.pop_front();
+            return true;
+        }
+
+        // Steal from the back of the fullest deque of another worker. Returns
+        // false if all are empty.
+        static bool steal(std::vector<Deque> &deques, uint thief, size_t &i) {
+            while( true ) {
+                size_t victim = deques.size(), max_size = 0;
+                for( size_t w = 0; w < deques.size(); ++w ) {
+                    std::lock_guard<std::mutex> lock(deques[w].mutex);
+                    if( (w != thief) && (deques[w].tasks.size() > max_size) ) {
+                        victim = w;
+                        max_size = deques[w].tasks.size();
+                    }
+                }
+                if( victim == deques.size() ) return false;
+
+                std::lock_guard<std::mutex> lock(deques[victim].mutex);
+                if( !deques[victim].tasks.empty() ) {
+                    i = deques[victim].tasks.back();
+                    deques[victim].tasks.pop_back();
+                    return true;
+                }
+            }
+        }
+    };
+}
+
+#endif // WORK_STEALING_POOL_H
+
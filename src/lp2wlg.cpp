@@ -0,0 +1,52 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "BinaryGraph.h"
+#include "LPReader.h"
+
+using namespace std;
+
+void usage(const string &exec_name, ostream &os) {
+    os << "Usage: " << exec_name << " [--help] input output" << endl
+       << endl
+       << "Convert graph in clingo file (ext .lp) into binary graph (ext .wlg)." << endl
+       << endl
+       << "positional arguments:" << endl
+       << "  input                         clingo file containing graph" << endl
+       << "  output                        binary file to write" << endl
+       << endl
+       << "optional arguments:" << endl
+       << "  --help                        show this help message and exit" << endl;
+}
+
+int main(int argc, const char **argv) {
+    string exec_name(*argv++);
+    --argc;
+
+    if( (argc > 0) && (string(*argv) == "--help") ) {
+        usage(exec_name, cout);
+        return 0;
+    } else if( argc != 2 ) {
+        usage(exec_name, cout);
+        return -1;
+    }
+
+    string input = argv[0], output = argv[1];
+    GraphLibrary::LPGraph lp_graph;
+    string error;
+    auto start = chrono::high_resolution_clock::now();
+    if( !GraphLibrary::read_lp_file(input, lp_graph, error) ) {
+        cout << "Error: " << error << endl;
+        return -1;
+    }
+    if( !GraphLibrary::write_binary_file(output, lp_graph, error) ) {
+        cout << "Error: " << error << endl;
+        return -1;
+    }
+    auto end = chrono::high_resolution_clock::now();
+    double elapsed = chrono::duration<double>(end - start).count();
+    cout << "graph: #nodes=" << lp_graph.num_nodes << ", #edges=" << lp_graph.edges_src.size() << ", #edge-labels=" << lp_graph.label_names.size() << endl;
+    cout << "convert: '" << input << "' -> '" << output << "', elapsed-time=" << elapsed << endl;
+    return 0;
+}
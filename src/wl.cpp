@@ -1,183 +1,750 @@
 #include <chrono>
-#include <iostream>
+#include <condition_variable>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/algorithm/string/predicate.hpp>
 
+#include "BinaryGraph.h"
+#include "CanonicalLabeling.h"
 #include "Graph.h"
+#include "CSRGraph.h"
 #include "ColorRefinement.h"
+#include "ColoringWriter.h"
+#include "ExternalRefinement.h"
+#include "IncrementalRefinement.h"
+#include "JointRefinement.h"
+#include "KWLRefinement.h"
+#include "LPReader.h"
+#include "NodeOrdering.h"
+#include "PartitionRefinement.h"
+#include "ShardedRefinement.h"
+#include "SubsetRefinement.h"
+#include "WLServer.h"
+#include "WLKernel.h"
+#include "WorkStealingPool.h"
 
 
 using namespace std;
 
-string join(const vector<string> &args) {
-    string result;
-    for( size_t i = 0; i < args.size(); ++i ) {
-        result += args[i];
-        if( 1 + i < args.size() ) result += ",";
-    }
-    return result;
-}
-
-vector<string> get_args(const string &atom, bool verbose = false) {
-    vector<string> args;
-    size_t pos = atom.find_first_of("("), n = 0, rbegin = 0;
-    for( size_t i = pos, len = atom.size(); i < len; ++i ) {
-        if( (n == 0) && (atom.at(i) == '(') ) {
-            ++n;
-            rbegin = i + 1;
-        } else if( atom.at(i) == '(' ) {
-            if( n == 1 ) rbegin = i;
-            ++n;
-        } else if( (n == 1) && ((atom.at(i) == ',') || atom.at(i) == ')') ) {
-            int rlen = i - rbegin;
-            string arg = atom.substr(rbegin, rlen);
-            if( verbose ) cout << "get_args: pos=" << args.size() << ", arg=|" << arg << "|" << endl;
-            args.emplace_back(move(arg));
-            if( atom.at(i) == ',' )
-                rbegin = i + 1;
-            else
-                --n;
-        } else if( atom.at(i) == ')' ) {
-            assert(n > 0);
-            --n;
-        }
-    }
-    assert(n == 0);
-    return args;
-}
-
-GraphLibrary::Graph read_lp_graph(ifstream &ifs, bool uniform_initial_coloring, bool use_chosen_labels) {
-    using boost::algorithm::starts_with;
-    using boost::algorithm::ends_with;
-
-    map<string, Node> map_node;
-    map<uint, string> map_label;
-    map<pair<string, string>, uint> map_edge;
-    map<pair<string, string>, Labels> map_edge_labels;
-    map<string, uint> map_color;
-    set<uint> chosen_labels;
-
-    string ifs_line;
-    while( getline(ifs, ifs_line) ) {
-        if( starts_with(ifs_line, "node(") ) {
-            vector<string> args = get_args(ifs_line);
-            assert(args.size() == 1);
-            string node = join(args);
-            assert(map_node.find(node) == map_node.end());
-            map_node.emplace(node, map_node.size());
-        } else if( starts_with(ifs_line, "labelname(") ) {
-            vector<string> args = get_args(ifs_line);
-            assert(args.size() == 2);
-            uint index = atoi(args[0].c_str());
-            const string &label = args[1];
-            assert(map_label.find(index) == map_label.end());
-            map_label.emplace(index, label);
-        } else if( starts_with(ifs_line, "edge(") ) {
-            vector<string> args = get_args(ifs_line);
-            assert(args.size() == 1);
-            vector<string> edge_args = get_args(args[0]);
-            assert(edge_args.size() == 2);
-            string src = edge_args[0];
-            string dst = edge_args[1];
-            pair<string, string> edge(src, dst);
-            assert(map_edge.find(edge) == map_edge.end());
-            map_edge.emplace(edge, map_edge.size());
-        } else if( starts_with(ifs_line, "tlabel(") ) {
-            vector<string> args = get_args(ifs_line);
-            assert(args.size() == 2);
-            uint label = atoi(args[1].c_str());
-            vector<string> edge_args = get_args(args[0]);
-            assert(edge_args.size() == 2);
-            string src = edge_args[0];
-            string dst = edge_args[1];
-            pair<string, string> edge(src, dst);
-            if( map_edge_labels.find(edge) == map_edge_labels.end() )
-                map_edge_labels.emplace(edge, Labels{});
-            map_edge_labels[edge].push_back(label);
-        } else if( starts_with(ifs_line, "chosen(") ) {
-            vector<string> args = get_args(ifs_line);
-            assert(args.size() == 1);
-            uint label = atoi(args[0].c_str());
-            chosen_labels.insert(label);
-        } else if( starts_with(ifs_line, "color(") ) {
-            vector<string> args = get_args(ifs_line);
-            assert(args.size() == 2);
-            string node = args[0];
-            uint color = atoi(args[1].c_str());
-            map_color.emplace(node, color);
-        }
-    }
-
-    int num_nodes = map_node.size();
-    int num_edges = map_edge.size();
-    int num_labels = map_label.size();
-    cout << "graph: #nodes=" << num_nodes << ", #edges=" << num_edges << ", #edge-labels=" << num_labels << endl;
-
-    // check consistency
-    for( map<pair<string, string>, uint>::const_iterator it = map_edge.begin(); it != map_edge.end(); ++it ) {
-        assert(map_node.find(it->first.first) != map_node.end());
-        assert(map_node.find(it->first.second) != map_node.end());
-    }
-    for( map<pair<string, string>, Labels>::const_iterator it = map_edge_labels.begin(); it != map_edge_labels.end(); ++it ) {
-        assert(map_node.find(it->first.first) != map_node.end());
-        assert(map_node.find(it->first.second) != map_node.end());
-        for( size_t i = 0; i < it->second.size(); ++i )
-            assert(map_label.find(it->second[i]) != map_label.end());
-    }
-
-    // normalize edge labels
-    map<uint, uint> remap_label;
-    for( map<uint, string>::const_iterator it = map_label.begin(); it != map_label.end(); ++it )
-        remap_label.emplace(it->first, remap_label.size());
-
-    // setup (initial) node colors (if specified), otherwise initial coloring is uniform
-    Labels node_labels(num_nodes, 1);
-    if( !uniform_initial_coloring ) {
-        for( map<string, uint>::const_iterator it = map_color.begin(); it != map_color.end(); ++it ) {
-            uint node = map_node.at(it->first);
-            uint color = it->second;
-            assert(node < num_nodes);
-            node_labels[node] = color;
-        }
-    }
-
-    // setup edges
-    Labels edge_labels;
-    Nodes edges_src, edges_dst;
-    for( map<pair<string, string>, uint>::const_iterator it = map_edge.begin(); it != map_edge.end(); ++it ) {
-        const Labels &labels = map_edge_labels.at(it->first);
-        assert(labels.size() == 1);
-        uint label = labels.front();
-        if( !use_chosen_labels || (chosen_labels.find(label) != chosen_labels.end()) ) {
-            edges_src.push_back(map_node.at(it->first.first));
-            edges_dst.push_back(map_node.at(it->first.second));
-            edge_labels.push_back(remap_label.at(label));
-        }
-    }
-
-    // construct and return graph
-    return GraphLibrary::Graph(num_nodes, edges_src, edges_dst, edge_labels, node_labels, true);
-}
-
 void usage(const string &exec_name, ostream &os) {
-    os << "Usage: " << exec_name << " [--disable-chosen-labels] [--help] [--normalize-colors] [--uniform-initial-coloring] filename" << endl
+    os << "Usage: " << exec_name << " [--cache-dir DIR] [--cache-size MB] [--canonical] [--compare] [--database FILE] [--disable-chosen-labels] [--exact-colors] [--external] [--help] [--jobs N] [--k-wl K] [--kernel H] [--kernel-gram FILE] [--label-subsets FILE] [--max-memory MB] [--max-payload MB] [--max-rounds N] [--memory-budget MB] [--normalize-colors] [--output FILE] [--output-format FORMAT] [--partition-refinement] [--processes N] [--reorder ORDER] [--seed S] [--server] [--socket PATH] [--sparse-labels] [--stats FORMAT] [--temp-dir DIR] [--threads N] [--time-budget SECONDS] [--uniform-initial-coloring] [--updates FILE] filename ..." << endl
        << endl
        << "positional arguments:" << endl
-       << "  filename                      file containing graph" << endl
+       << "  filename                      file containing graph, or directory of .lp/.wlg files (several files are processed in batch)" << endl
        << endl
        << "optional arguments:" << endl
        << "  --help                        show this help message and exit" << endl
+       << "  --cache-dir DIR               with --server or --socket, also cache colorings on disk in DIR" << endl
+       << "  --cache-size MB               with --server or --socket, memory for cached colorings (default 256)" << endl
+       << "  --canonical                   compute canonical labeling, orbits and automorphism generators by individualization-refinement" << endl
+       << "  --compare                     compare two graphs, refining them jointly until their color histograms differ" << endl
+       << "  --database FILE               also read graphs from the files listed in FILE (one per line)" << endl
        << "  --disable-chosen-labels       don't use chosen() atoms in input (if enabled, all labels are considered)" << endl
-       << "  --normalize-colors            normalize node colors after each iteration to reduce overflows" << endl
+       << "  --exact-colors                intern node signatures into dense colors (no overflows); the last round is skipped when stability can be decided cheaply" << endl
+       << "  --external                    refine .wlg files out of core: edges are streamed from the file in each round (node colors stay in memory)" << endl
+       << "  --jobs N                      process N files at a time in batch (results are written in input order)" << endl
+       << "  --k-wl K                      compute stable coloring of k-tuples with folklore K-dimensional WL (K = 2 or 3), as powerful as classical (K+1)-dimensional WL" << endl
+       << "  --kernel H                    write WL subtree kernel features of all graphs for H rounds (svmlight format)" << endl
+       << "  --kernel-gram FILE            with --kernel, write Gram matrix of graphs to FILE" << endl
+       << "  --label-subsets FILE          count colors of the stable coloring for each subset of labels in FILE (one per line)" << endl
+       << "  --max-memory MB               maximum memory used by --k-wl (default 4096)" << endl
+       << "  --max-payload MB              with --server or --socket, largest graph accepted in a request (default 1024)" << endl
+       << "  --max-rounds N                stop after N rounds of refinement (the coloring may not be stable)" << endl
+       << "  --memory-budget MB            memory for buffering signatures with --external (default 256)" << endl
+       << "  --normalize-colors            normalize node colors after each iteration to reduce overflows; the last round is skipped when stability can be decided cheaply" << endl
+       << "  --output FILE                 write coloring to FILE instead of standard output" << endl
+       << "  --output-format FORMAT        format of coloring: text (default), asp (facts color(N,C).) or binary" << endl
+       << "  --partition-refinement        compute stable coloring with splitter-based partition refinement" << endl
+       << "  --processes N                 compute exact colors with N worker processes sharing colors in memory (implies --exact-colors)" << endl
+       << "  --reorder ORDER               refine with nodes renumbered for locality: bfs, rcm (reverse Cuthill-McKee), color-degree or input (default)" << endl
+       << "  --seed S                      seed of the random weights of --k-wl fingerprints (default 0); two classes are merged wrongly with probability at most r*K^2*N^2/2^59 (r rounds, N = n^K tuples)" << endl
+       << "  --server                      serve requests on standard input/output (see WLServer.h for the protocol)" << endl
+       << "  --socket PATH                 serve requests on a Unix domain socket at PATH" << endl
+       << "  --sparse-labels               only fold the edge labels that each node has (cost independent of #labels)" << endl
+       << "  --stats FORMAT                report timings of phases and statistics of each round: text or json (one object per file)" << endl
+       << "  --temp-dir DIR                directory of temporary files of --external (default /tmp)" << endl
+       << "  --threads N                   compute exact colors using N threads (implies --exact-colors)" << endl
+       << "  --time-budget SECONDS         don't start new rounds of refinement after SECONDS (the coloring may not be stable)" << endl
        << "  --uniform-initial-coloring    force uniform initial node coloring" << endl
+       << "  --updates FILE                apply the batches of edits in FILE to the graph, refining incrementally after each batch" << endl
        << endl
-       << "Note: use --disable-chosen-labels for using all labels in graph" << endl;
+       << "Note: use --disable-chosen-labels for using all labels in graph" << endl
+       << "Note: without --exact-colors or --normalize-colors, the last round, which confirms that the coloring is stable, is always run" << endl;
+}
+
+// Read graph in file and append its CSR view to "csr_db". Edge labels are
+// label indices of the file, so that they agree among graphs.
+bool read_graph_with_label_indices(const string &filename,
+                                   bool uniform_initial_coloring,
+                                   bool use_chosen_labels,
+                                   vector<GraphLibrary::CSRGraph> &csr_db,
+                                   string &error) {
+    if( boost::algorithm::ends_with(filename, ".lp") ) {
+        GraphLibrary::LPGraph lp_graph;
+        if( !GraphLibrary::read_lp_file(filename, lp_graph, error) ) return false;
+        csr_db.push_back(GraphLibrary::make_csr_graph(lp_graph, uniform_initial_coloring, use_chosen_labels));
+    } else if( boost::algorithm::ends_with(filename, ".wlg") ) {
+        GraphLibrary::BinaryGraph binary_graph;
+        if( !GraphLibrary::read_binary_file(filename, binary_graph, error) ) return false;
+        csr_db.push_back(GraphLibrary::make_csr_graph(binary_graph, uniform_initial_coloring, use_chosen_labels, true));
+    } else {
+        error = "unrecognized file extension of '" + filename + "'";
+        return false;
+    }
+    return true;
+}
+
+// Compare two graphs with joint refinement, stopping at the first round
+// where their color histograms differ.
+int compare_graphs(const vector<string> &filenames, bool uniform_initial_coloring, bool use_chosen_labels) {
+    if( filenames.size() != 2 ) {
+        cout << "Error: --compare requires two files" << endl;
+        return -1;
+    }
+    vector<GraphLibrary::CSRGraph> csr_db;
+    for( const string &filename : filenames ) {
+        string error;
+        if( !read_graph_with_label_indices(filename, uniform_initial_coloring, use_chosen_labels, csr_db, error) ) {
+            cout << "Error: " << error << endl;
+            return -1;
+        }
+    }
+
+    ColorRefinement::JointRefinement joint(csr_db[0], csr_db[1]);
+    auto start = chrono::high_resolution_clock::now();
+    int round = joint.distinguish();
+    auto end = chrono::high_resolution_clock::now();
+    double elapsed = chrono::duration<double>(end - start).count();
+    cout << "compare: #rounds=" << joint.get_num_rounds() << ", elapsed-time=" << elapsed << endl;
+    if( round >= 0 )
+        cout << "distinguished at round " << round << endl;
+    else
+        cout << "not distinguished" << endl;
+    return 0;
+}
+
+// Count the colors of the stable coloring of the graph in each file for
+// each subset of labels listed in "subsets_filename": one subset per line,
+// label indices (as in chosen/1) separated by spaces or commas. Braces are
+// ignored, so "{}" is the empty subset.
+int evaluate_label_subsets(const vector<string> &filenames,
+                           const string &subsets_filename,
+                           bool uniform_initial_coloring,
+                           const ColorRefinement::Options &options) {
+    vector<vector<uint> > subsets;
+    ifstream is(subsets_filename);
+    if( !is ) {
+        cout << "Error: opening file '" << subsets_filename << "'" << endl;
+        return -1;
+    }
+    for( string line; getline(is, line); ) {
+        if( line.find_first_not_of(" \t\r") == string::npos ) continue;
+        for( char &c : line ) {
+            if( (c == ',') || (c == '{') || (c == '}') ) c = ' ';
+        }
+        istringstream iss(line);
+        vector<uint> subset;
+        for( string label; iss >> label; ) {
+            if( label.find_first_not_of("0123456789") != string::npos ) {
+                cout << "Error: invalid label '" << label << "' in file '" << subsets_filename << "'" << endl;
+                return -1;
+            }
+            subset.push_back(stoul(label));
+        }
+        subsets.push_back(subset);
+    }
+
+    for( const string &filename : filenames ) {
+        cout << "Reading file '" << filename << "' ..." << endl;
+        vector<GraphLibrary::CSRGraph> csr_db;
+        string error;
+        if( !read_graph_with_label_indices(filename, uniform_initial_coloring, false, csr_db, error) ) {
+            cout << "Error: " << error << endl;
+            return -1;
+        }
+
+        ColorRefinement::SubsetRefinement sr(csr_db[0]);
+        vector<ColorRefinement::SubsetRefinement::Result> results;
+        auto start = chrono::high_resolution_clock::now();
+        sr.compute(subsets, results, options);
+        auto end = chrono::high_resolution_clock::now();
+        double elapsed = chrono::duration<double>(end - start).count();
+        size_t num_refined = 0;
+        for( size_t i = 0; i < subsets.size(); ++i ) {
+            const ColorRefinement::SubsetRefinement::Result &result = results[i];
+            num_refined += result.num_iterations > 0 ? 1 : 0;
+            cout << "subset: #subset=" << i << ", labels={";
+            for( size_t j = 0; j < subsets[i].size(); ++j )
+                cout << (j > 0 ? "," : "") << subsets[i][j];
+            cout << "}, #colors=" << result.num_colors << ", #iterations=" << result.num_iterations << ", seed=" << result.seed << endl;
+        }
+        cout << "subsets: #subsets=" << subsets.size() << ", #refined=" << num_refined << ", elapsed-time=" << elapsed
+             << ", throughput=" << (elapsed > 0 ? subsets.size() / elapsed : 0) << " subsets/s" << endl;
+    }
+    return 0;
+}
+
+// Compute canonical labeling, orbits and automorphism generators of the
+// graph in each file. Output lines are "canonical(v,i)", "orbit(v,o)" with
+// "o" the smallest node in the orbit of "v", and "generator g : cycles".
+int compute_canonical_labelings(const vector<string> &filenames,
+                                bool uniform_initial_coloring,
+                                bool use_chosen_labels,
+                                GraphLibrary::BufferedWriter &writer) {
+    for( const string &filename : filenames ) {
+        cout << "Reading file '" << filename << "' ..." << endl;
+        vector<GraphLibrary::CSRGraph> csr_db;
+        string error;
+        if( !read_graph_with_label_indices(filename, uniform_initial_coloring, use_chosen_labels, csr_db, error) ) {
+            cout << "Error: " << error << endl;
+            return -1;
+        }
+        const GraphLibrary::CSRGraph &csr = csr_db[0];
+
+        ColorRefinement::CanonicalLabeling canon(csr);
+        auto start = chrono::high_resolution_clock::now();
+        canon.compute();
+        auto end = chrono::high_resolution_clock::now();
+        double elapsed = chrono::duration<double>(end - start).count();
+        size_t num_orbits = 0;
+        for( Node v = 0; v < csr.get_num_nodes(); ++v )
+            num_orbits += canon.get_orbits()[v] == v;
+        cout << "canonical: #nodes=" << csr.get_num_nodes() << ", #tree-nodes=" << canon.get_num_tree_nodes() << ", #leaves=" << canon.get_num_leaves()
+             << ", #generators=" << canon.get_generators().size() << ", #orbits=" << num_orbits << ", hash=" << canon.get_hash()
+             << ", elapsed-time=" << elapsed << endl;
+
+        for( Node v = 0; v < csr.get_num_nodes(); ++v ) {
+            writer.put("canonical(");
+            writer.put_uint(v);
+            writer.put(',');
+            writer.put_uint(canon.get_labeling()[v]);
+            writer.put(")\n");
+        }
+        for( Node v = 0; v < csr.get_num_nodes(); ++v ) {
+            writer.put("orbit(");
+            writer.put_uint(v);
+            writer.put(',');
+            writer.put_uint(canon.get_orbits()[v]);
+            writer.put(")\n");
+        }
+        for( size_t g = 0; g < canon.get_generators().size(); ++g ) {
+            const Nodes &generator = canon.get_generators()[g];
+            writer.put("generator ");
+            writer.put_uint(1 + g);
+            writer.put(" :");
+            vector<bool> seen(generator.size(), false);
+            for( Node v = 0; v < generator.size(); ++v ) {
+                if( seen[v] || (generator[v] == v) ) continue;
+                writer.put(" (");
+                for( Node w = v; !seen[w]; w = generator[w] ) {
+                    if( w != v ) writer.put(' ');
+                    writer.put_uint(w);
+                    seen[w] = true;
+                }
+                writer.put(')');
+            }
+            writer.put('\n');
+        }
+        if( !writer.flush() ) {
+            cout << "Error: writing canonical labeling" << endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Compute WL subtree kernel of graphs in files.
+int compute_kernel(const vector<string> &filenames,
+                   int num_rounds,
+                   uint num_threads,
+                   bool uniform_initial_coloring,
+                   bool use_chosen_labels,
+                   GraphLibrary::BufferedWriter &writer,
+                   const string &gram_filename) {
+    vector<GraphLibrary::CSRGraph> csr_db;
+    auto start = chrono::high_resolution_clock::now();
+    for( const string &filename : filenames ) {
+        string error;
+        if( !read_graph_with_label_indices(filename, uniform_initial_coloring, use_chosen_labels, csr_db, error) ) {
+            cout << "Error: " << error << endl;
+            return -1;
+        }
+    }
+    auto end = chrono::high_resolution_clock::now();
+    size_t num_nodes = 0;
+    for( const GraphLibrary::CSRGraph &csr : csr_db )
+        num_nodes += csr.get_num_nodes();
+    cout << "database: #graphs=" << csr_db.size() << ", #nodes=" << num_nodes << ", elapsed-time=" << chrono::duration<double>(end - start).count() << endl;
+
+    vector<const GraphLibrary::CSRGraph*> graphs;
+    for( const GraphLibrary::CSRGraph &csr : csr_db )
+        graphs.push_back(&csr);
+    ColorRefinement::WLKernel kernel(graphs);
+    start = chrono::high_resolution_clock::now();
+    kernel.compute_features(num_rounds, num_threads);
+    end = chrono::high_resolution_clock::now();
+    cout << "WL-kernel: #rounds=" << num_rounds << ", #features=" << kernel.get_num_features() << ", #nonzeros=" << kernel.get_feature_ids().size()
+         << ", elapsed-time=" << chrono::duration<double>(end - start).count() << endl;
+    kernel.write_features(writer);
+    if( !writer.flush() ) {
+        cout << "Error: writing features" << endl;
+        return -1;
+    }
+
+    if( !gram_filename.empty() ) {
+        FILE *file = fopen(gram_filename.c_str(), "w");
+        if( file == nullptr ) {
+            cout << "Error: opening file '" << gram_filename << "'" << endl;
+            return -1;
+        }
+        start = chrono::high_resolution_clock::now();
+        bool ok;
+        {
+            GraphLibrary::BufferedWriter gram_writer(file);
+            kernel.write_gram_matrix(gram_writer, num_threads);
+            ok = gram_writer.flush();
+        }
+        ok = (fclose(file) == 0) && ok;
+        end = chrono::high_resolution_clock::now();
+        if( !ok ) {
+            cout << "Error: writing Gram matrix" << endl;
+            return -1;
+        }
+        cout << "gram: elapsed-time=" << chrono::duration<double>(end - start).count() << endl;
+    }
+    return 0;
+}
+
+// Settings for coloring each graph.
+struct Settings {
+    ColorRefinement::Options refinement;
+    bool use_chosen_labels;
+    bool uniform_initial_coloring;
+    bool partition_refinement;
+    bool external;
+    ColorRefinement::ExternalRefinement::Options external_options;
+    // Number of worker processes of sharded refinement (1 for none).
+    uint num_processes;
+    // Order of nodes in the refined view (colors are output for input ids).
+    GraphLibrary::NodeOrdering node_ordering;
+    uint k;
+    ColorRefinement::KWLRefinement::Options kwl;
+    ColorRefinement::ColoringWriter::Format output_format;
+    // Format of statistics ("text" or "json"), or empty for none.
+    string stats;
+    // File of batches of edits applied by incremental refinement, or empty
+    // for none.
+    string updates;
+
+    Settings()
+      : use_chosen_labels(true),
+        uniform_initial_coloring(false),
+        partition_refinement(false),
+        external(false),
+        num_processes(1),
+        node_ordering(GraphLibrary::NodeOrdering::Input),
+        k(1),
+        output_format(ColorRefinement::ColoringWriter::Format::Text) {
+    }
+};
+
+// Write string as JSON string literal.
+void write_json_string(ostream &os, const string &str) {
+    os << '"';
+    for( char c : str ) {
+        if( (c == '"') || (c == '\\') ) {
+            os << '\\' << c;
+        } else if( (unsigned char)c < 0x20 ) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            os << escaped;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+// Timings of the phases of process_file() (in seconds) and statistics of
+// the rounds of refinement.
+struct FileStats {
+    double parse;
+    double build;
+    double remap;
+    double refine;
+    double output;
+    size_t num_nodes;
+    size_t num_edges;
+    vector<ColorRefinement::RoundStats> rounds;
+    // Why the engine has no statistics of rounds, or empty if it has.
+    string no_rounds;
+
+    FileStats() : parse(0), build(0), remap(0), refine(0), output(0), num_nodes(0), num_edges(0) { }
+
+    void write(ostream &os, const string &filename, const string &format) const {
+        if( format == "json" ) {
+            os << "{\"file\":";
+            write_json_string(os, filename);
+            os << ",\"nodes\":" << num_nodes
+               << ",\"edges\":" << num_edges
+               << ",\"phases\":{\"parse\":" << parse << ",\"build\":" << build << ",\"remap\":" << remap
+               << ",\"refine\":" << refine << ",\"output\":" << output << "}"
+               << ",\"rounds\":" << (no_rounds.empty() ? "[" : "null");
+            for( size_t i = 0; i < rounds.size(); ++i ) {
+                const ColorRefinement::RoundStats &round = rounds[i];
+                os << (i > 0 ? "," : "")
+                   << "{\"time\":" << round.elapsed_time
+                   << ",\"colors\":" << round.num_colors
+                   << ",\"changed\":" << round.num_changed
+                   << ",\"largest_class\":" << round.largest_class
+                   << ",\"arcs_scanned\":" << round.num_arcs_scanned
+                   << ",\"peak_memory_kb\":" << round.peak_memory << "}";
+            }
+            os << (no_rounds.empty() ? "]" : "") << ",\"peak_memory_kb\":" << ColorRefinement::get_peak_memory() << "}" << endl;
+        } else {
+            if( !no_rounds.empty() ) os << "rounds: none (" << no_rounds << ")" << endl;
+            for( size_t i = 0; i < rounds.size(); ++i ) {
+                const ColorRefinement::RoundStats &round = rounds[i];
+                os << "round: #round=" << 1 + i
+                   << ", #colors=" << round.num_colors
+                   << ", #changed=" << round.num_changed
+                   << ", largest-class=" << round.largest_class
+                   << ", #arcs-scanned=" << round.num_arcs_scanned
+                   << ", peak-memory=" << round.peak_memory << " KB"
+                   << ", elapsed-time=" << round.elapsed_time << endl;
+            }
+            os << "phases: parse=" << parse << ", build=" << build << ", remap=" << remap
+               << ", refine=" << refine << ", output=" << output
+               << ", peak-memory=" << ColorRefinement::get_peak_memory() << " KB" << endl;
+        }
+    }
+};
+
+// Compute stable coloring of binary graph in file out of core, and write
+// it. Messages go to "os". Returns false on error.
+bool process_file_external(const string &filename, const Settings &settings, ostream &os, ColorRefinement::ColoringWriter &writer) {
+    if( !boost::algorithm::ends_with(filename, ".wlg") ) {
+        os << "Error: --external requires a binary graph file (ext .wlg)" << endl;
+        return false;
+    }
+
+    FileStats stats;
+    ColorRefinement::ExternalRefinement er(filename, settings.uniform_initial_coloring, settings.use_chosen_labels);
+    ColorRefinement::ExternalRefinement::Options options = settings.external_options;
+    options.max_rounds = settings.refinement.max_rounds;
+    options.time_budget = settings.refinement.time_budget;
+    if( !settings.stats.empty() ) options.round_stats = &stats.rounds;
+    bool stable = true;
+    options.stable = &stable;
+    ColorRefinement::Coloring coloring;
+    string error;
+    auto start = chrono::high_resolution_clock::now();
+    int num_iterations = er.compute_stable_coloring(coloring, options, error);
+    auto end = chrono::high_resolution_clock::now();
+    if( num_iterations < 0 ) {
+        os << "Error: " << error << endl;
+        return false;
+    }
+    double elapsed = chrono::duration<double>(end - start).count();
+    stats.refine = elapsed;
+    stats.num_nodes = er.get_num_nodes();
+    stats.num_edges = er.get_num_arcs();
+    os << "graph: #nodes=" << er.get_num_nodes() << ", #edges=" << er.get_num_arcs() << endl;
+    os << "WL: #iterations=" << num_iterations << ", #colors=" << coloring.get_num_colors() << (stable ? "" : ", stable=false") << ", elapsed-time=" << elapsed << endl;
+    os << "external: #runs=" << er.get_num_runs()
+       << ", #bytes-read=" << er.get_num_bytes_read()
+       << ", throughput=" << (elapsed > 0 ? er.get_num_bytes_read() / elapsed / 1e6 : 0) << " MB/s" << endl;
+
+    // Print coloring.
+    start = chrono::high_resolution_clock::now();
+    writer.write(coloring, settings.output_format);
+    if( !writer.flush() ) {
+        os << "Error: writing coloring" << endl;
+        return false;
+    }
+    end = chrono::high_resolution_clock::now();
+    stats.output = chrono::duration<double>(end - start).count();
+    if( !settings.stats.empty() ) stats.write(os, filename, settings.stats);
+    return true;
+}
+
+// Mean distance between the ids of the endpoints of the arcs.
+double get_mean_arc_span(const GraphLibrary::CSRGraph &csr) {
+    double span = 0;
+    for( Node v = 0; v < csr.get_num_nodes(); ++v ) {
+        for( const GraphLibrary::CSRGraph::Arc *a = csr.outbound_begin(v); a != csr.outbound_end(v); ++a )
+            span += a->node > v ? a->node - v : v - a->node;
+    }
+    return csr.get_num_edges() > 0 ? span / csr.get_num_edges() : 0;
+}
+
+// Map coloring of a view with nodes renumbered by "new_id" back to the
+// nodes of the input. Dense colors are numbered again in order of first
+// occurrence, so they are the same as without renumbering.
+void restore_node_order(ColorRefinement::Coloring &coloring, const Nodes &new_id, bool dense_colors) {
+    Labels node_colors(new_id.size());
+    for( Node v = 0; v < new_id.size(); ++v )
+        node_colors[v] = coloring.node_to_color[new_id[v]];
+    if( dense_colors ) {
+        Labels renumbered(1 + coloring.get_num_colors(), 0);
+        Label num_colors = 0;
+        for( Label &color : node_colors ) {
+            if( renumbered[color] == 0 ) renumbered[color] = ++num_colors;
+            color = renumbered[color];
+        }
+    }
+    coloring.assign(std::move(node_colors));
+}
+
+// Refine the graph incrementally under the batches of edits in file
+// "updates_filename", one edit per line:
+//
+//   add-node LABEL            add node (with next id) with given label
+//   add-edge V W [LABEL]      add edge (V,W) with given label (default 0)
+//   remove-edge V W [LABEL]   remove an edge (V,W) with given label
+//   remove-edges V            remove all edges incident to V
+//   set-label V LABEL         set label of node V
+//   update                    end of batch
+//
+// Labels are those of the CSR view: initial colors of nodes and indices of
+// edge labels. Blank lines and lines starting with '%' are skipped, and the
+// end of the file ends the last batch. A line is written after each batch,
+// and "coloring" is set to the stable coloring after the last one.
+bool apply_updates(const GraphLibrary::CSRGraph &csr, const string &updates_filename, ostream &os, ColorRefinement::Coloring &coloring) {
+    ifstream is(updates_filename);
+    if( !is ) {
+        os << "Error: opening file '" << updates_filename << "'" << endl;
+        return false;
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    ColorRefinement::IncrementalRefinement inc(csr);
+    auto end = chrono::high_resolution_clock::now();
+    os << "WL: #iterations=" << inc.get_num_rounds() << ", #colors=" << inc.get_num_colors() << ", elapsed-time=" << chrono::duration<double>(end - start).count() << endl;
+
+    size_t num_batches = 0, num_edits = 0, line_number = 0;
+    for( string line; true; ) {
+        bool eof = !getline(is, line);
+        ++line_number;
+        istringstream iss(line);
+        string edit;
+        if( !eof && (!(iss >> edit) || (edit[0] == '%')) ) continue;
+
+        if( eof || (edit == "update") ) {
+            if( eof && (num_edits == 0) ) break;
+            start = chrono::high_resolution_clock::now();
+            size_t num_recolored = inc.update();
+            end = chrono::high_resolution_clock::now();
+            os << "update: #batch=" << ++num_batches << ", #edits=" << num_edits << ", #recolored=" << num_recolored
+               << ", #iterations=" << inc.get_num_rounds() << ", #colors=" << inc.get_num_colors()
+               << ", elapsed-time=" << chrono::duration<double>(end - start).count() << endl;
+            num_edits = 0;
+            if( eof ) break;
+            continue;
+        }
+
+        // Arguments: nodes must exist, and trailing label is optional for edges.
+        ulong v = 0, w = 0, label = 0;
+        bool ok = true;
+        if( edit == "add-node" ) {
+            ok = bool(iss >> label);
+        } else if( (edit == "add-edge") || (edit == "remove-edge") ) {
+            ok = (iss >> v >> w) && (v < inc.get_num_nodes()) && (w < inc.get_num_nodes());
+            if( ok && !(iss >> label) ) {
+                label = 0;
+                iss.clear();
+            }
+        } else if( edit == "remove-edges" ) {
+            ok = (iss >> v) && (v < inc.get_num_nodes());
+        } else if( edit == "set-label" ) {
+            ok = (iss >> v >> label) && (v < inc.get_num_nodes());
+        } else {
+            ok = false;
+        }
+        string rest;
+        if( !ok || (iss >> rest) ) {
+            os << "Error: invalid edit '" << line << "' at line " << line_number << " of file '" << updates_filename << "'" << endl;
+            return false;
+        }
+
+        if( edit == "add-node" ) {
+            inc.add_node(label);
+        } else if( edit == "add-edge" ) {
+            inc.add_edge(v, w, label);
+        } else if( edit == "remove-edge" ) {
+            if( !inc.remove_edge(v, w, label) ) {
+                os << "Error: no edge (" << v << "," << w << ") with label " << label << " at line " << line_number << " of file '" << updates_filename << "'" << endl;
+                return false;
+            }
+        } else if( edit == "remove-edges" ) {
+            inc.remove_incident_edges(v);
+        } else {
+            inc.set_node_label(v, label);
+        }
+        ++num_edits;
+    }
+    inc.get_coloring(coloring);
+    return true;
+}
+
+// Read graph in file, compute its stable coloring and write it. Messages
+// go to "os". Returns false on error.
+bool process_file(const string &filename, const Settings &settings, ostream &os, ColorRefinement::ColoringWriter &writer) {
+    os << "Reading file '" << filename << "' ..." << endl;
+    if( settings.external ) return process_file_external(filename, settings, os, writer);
+
+    FileStats stats;
+
+    unique_ptr<GraphLibrary::CSRGraph> csr_ptr;
+    if( boost::algorithm::ends_with(filename, ".lp") ) {
+        // reading a graph description from clingo file (ext .lp)
+        GraphLibrary::LPGraph lp_graph;
+        string error;
+        auto start = chrono::high_resolution_clock::now();
+        if( !GraphLibrary::read_lp_file(filename, lp_graph, error) ) {
+            os << "Error: " << error << endl;
+            return false;
+        }
+        auto end = chrono::high_resolution_clock::now();
+        double elapsed = chrono::duration<double>(end - start).count();
+        os << "parse: #bytes=" << lp_graph.num_bytes
+           << ", elapsed-time=" << elapsed
+           << ", throughput=" << (elapsed > 0 ? lp_graph.num_bytes / elapsed / 1e6 : 0) << " MB/s" << endl;
+        os << "graph: #nodes=" << lp_graph.num_nodes << ", #edges=" << lp_graph.edges_src.size() << ", #edge-labels=" << lp_graph.label_names.size() << endl;
+        stats.parse = elapsed;
+        start = chrono::high_resolution_clock::now();
+        GraphLibrary::Graph g = GraphLibrary::make_graph(lp_graph, settings.uniform_initial_coloring, settings.use_chosen_labels);
+        end = chrono::high_resolution_clock::now();
+        stats.build = chrono::duration<double>(end - start).count();
+
+        // Remap edge labels so that they fall in { 0, ..., num_edge_labels - 1 },
+        // and build CSR view of graph with remapped labels.
+        start = chrono::high_resolution_clock::now();
+        csr_ptr.reset(new GraphLibrary::CSRGraph(GraphLibrary::make_remapped_csr_graph(g)));
+        end = chrono::high_resolution_clock::now();
+        stats.remap = chrono::duration<double>(end - start).count();
+    } else if( boost::algorithm::ends_with(filename, ".wlg") ) {
+        // mapping a graph from binary file (ext .wlg), see lp2wlg
+        GraphLibrary::BinaryGraph binary_graph;
+        string error;
+        auto start = chrono::high_resolution_clock::now();
+        if( !GraphLibrary::read_binary_file(filename, binary_graph, error) ) {
+            os << "Error: " << error << endl;
+            return false;
+        }
+        csr_ptr.reset(new GraphLibrary::CSRGraph(GraphLibrary::make_csr_graph(binary_graph, settings.uniform_initial_coloring, settings.use_chosen_labels)));
+        auto end = chrono::high_resolution_clock::now();
+        double elapsed = chrono::duration<double>(end - start).count();
+        os << "load: #bytes=" << binary_graph.num_bytes << ", elapsed-time=" << elapsed << endl;
+        stats.parse = elapsed;
+        os << "graph: #nodes=" << binary_graph.csr->get_num_nodes() << ", #edges=" << binary_graph.csr->get_num_edges() << ", #edge-labels=" << binary_graph.csr->get_num_edge_labels() << endl;
+    } else {
+        os << "Error: unrecognized file extension" << endl;
+        return false;
+    }
+
+    // Renumber nodes for locality.
+    Nodes new_id;
+    if( settings.node_ordering != GraphLibrary::NodeOrdering::Input ) {
+        auto start = chrono::high_resolution_clock::now();
+        new_id = GraphLibrary::compute_node_ordering(*csr_ptr, settings.node_ordering);
+        double old_span = get_mean_arc_span(*csr_ptr);
+        csr_ptr.reset(new GraphLibrary::CSRGraph(csr_ptr->permute_nodes(new_id)));
+        auto end = chrono::high_resolution_clock::now();
+        double elapsed = chrono::duration<double>(end - start).count();
+        os << "reorder: mean-arc-span=" << get_mean_arc_span(*csr_ptr) << " (was " << old_span << "), elapsed-time=" << elapsed << endl;
+        stats.remap += elapsed;
+    }
+    const GraphLibrary::CSRGraph &csr = *csr_ptr;
+    stats.num_nodes = csr.get_num_nodes();
+    stats.num_edges = csr.get_num_edges();
+
+    // Compute stable coloring.
+    ColorRefinement::Coloring coloring;
+    if( settings.k > 1 ) {
+        ColorRefinement::KWLRefinement kwl(csr, settings.k);
+        string error;
+        auto start = chrono::high_resolution_clock::now();
+        int num_iterations = kwl.compute_stable_coloring(coloring, settings.kwl, error);
+        auto end = chrono::high_resolution_clock::now();
+        if( num_iterations < 0 ) {
+            os << "Error: " << error << endl;
+            return false;
+        }
+        double elapsed = chrono::duration<double>(end - start).count();
+        stats.refine = elapsed;
+        stats.no_rounds = "rounds of k-tuples are not recorded";
+        os << settings.k << "-WL: #iterations=" << num_iterations << ", #colors=" << coloring.get_num_colors() << ", #tuple-colors=" << kwl.get_num_tuple_colors() << ", elapsed-time=" << elapsed << endl;
+    } else if( settings.partition_refinement ) {
+        ColorRefinement::PartitionRefinement pr(csr);
+        auto start = chrono::high_resolution_clock::now();
+        int num_splitters = pr.compute_stable_coloring(coloring, csr.get_node_labels());
+        auto end = chrono::high_resolution_clock::now();
+        double elapsed = chrono::duration<double>(end - start).count();
+        stats.refine = elapsed;
+        stats.no_rounds = "splitter-based refinement has no rounds";
+        os << "WL: #splitters=" << num_splitters << ", #colors=" << coloring.get_num_colors() << ", elapsed-time=" << elapsed << endl;
+    } else if( !settings.updates.empty() ) {
+        auto start = chrono::high_resolution_clock::now();
+        bool ok = apply_updates(csr, settings.updates, os, coloring);
+        auto end = chrono::high_resolution_clock::now();
+        if( !ok ) return false;
+        stats.refine = chrono::duration<double>(end - start).count();
+        stats.no_rounds = "batches of edits are reported instead";
+    } else if( settings.num_processes > 1 ) {
+        ColorRefinement::ShardedRefinement sr(csr, settings.num_processes);
+        ColorRefinement::Options options = settings.refinement;
+        if( !settings.stats.empty() ) options.round_stats = &stats.rounds;
+        bool stable = true;
+        options.stable = &stable;
+        string error;
+        auto start = chrono::high_resolution_clock::now();
+        int num_iterations = sr.compute_stable_coloring(coloring, csr.get_node_labels(), options, error);
+        auto end = chrono::high_resolution_clock::now();
+        if( num_iterations < 0 ) {
+            os << "Error: " << error << endl;
+            return false;
+        }
+        double elapsed = chrono::duration<double>(end - start).count();
+        stats.refine = elapsed;
+        os << "WL: #iterations=" << num_iterations << ", #colors=" << coloring.get_num_colors() << (stable ? "" : ", stable=false") << ", #processes=" << settings.num_processes << ", elapsed-time=" << elapsed << endl;
+    } else {
+        ColorRefinement::ColorRefinement cr(csr);
+        ColorRefinement::Options options = settings.refinement;
+        if( !settings.stats.empty() ) options.round_stats = &stats.rounds;
+        bool stable = true;
+        options.stable = &stable;
+        auto start = chrono::high_resolution_clock::now();
+        int num_iterations = cr.compute_stable_coloring(coloring, csr.get_node_labels(), options);
+        auto end = chrono::high_resolution_clock::now();
+        double elapsed = chrono::duration<double>(end - start).count();
+        stats.refine = elapsed;
+        os << "WL: #iterations=" << num_iterations << ", #colors=" << coloring.get_num_colors() << (stable ? "" : ", stable=false") << ", elapsed-time=" << elapsed << endl;
+    }
+
+    // Print coloring (of the input nodes).
+    auto start = chrono::high_resolution_clock::now();
+    if( !new_id.empty() ) restore_node_order(coloring, new_id, settings.partition_refinement || settings.refinement.exact_colors || settings.refinement.normalize_colors);
+    writer.write(coloring, settings.output_format);
+    if( !writer.flush() ) {
+        os << "Error: writing coloring" << endl;
+        return false;
+    }
+    auto end = chrono::high_resolution_clock::now();
+    stats.output = chrono::duration<double>(end - start).count();
+    if( !settings.stats.empty() ) stats.write(os, filename, settings.stats);
+    return true;
 }
 
 int main(int argc, const char **argv) {
@@ -185,19 +752,210 @@ int main(int argc, const char **argv) {
     --argc;
 
     // parse options
-    bool opt_normalize_colors = false;
-    bool opt_use_chosen_labels = true;
-    bool opt_uniform_initial_coloring = false;
+    Settings settings;
+    bool opt_canonical = false;
+    bool opt_compare = false;
+    uint opt_jobs = 1;
+    int opt_kernel_rounds = -1;
+    string opt_kernel_gram;
+    string opt_label_subsets;
+    string opt_database;
+    string opt_output;
+    bool opt_server = false;
+    string opt_socket;
+    ColorRefinement::WLServer::Options server_options;
     for( bool parsing_options = true; parsing_options && (argc > 0) && (**argv == '-'); --argc, ++argv ) {
-        if( string(*argv) == "--disable-chosen-labels" ) {
-            opt_use_chosen_labels = false;
+        if( (string(*argv) == "--cache-dir") || (string(*argv) == "--cache-size") || (string(*argv) == "--max-payload") ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            string option(*argv);
+            --argc;
+            ++argv;
+            if( option == "--cache-dir" ) {
+                server_options.cache_dir = *argv;
+            } else if( option == "--max-payload" ) {
+                server_options.max_payload = size_t(max(0.0, atof(*argv)) * (1 << 20));
+            } else {
+                server_options.cache_size = size_t(max(0.0, atof(*argv)) * (1 << 20));
+            }
+        } else if( string(*argv) == "--canonical" ) {
+            opt_canonical = true;
+        } else if( string(*argv) == "--compare" ) {
+            opt_compare = true;
+        } else if( string(*argv) == "--database" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            opt_database = *argv;
+        } else if( string(*argv) == "--disable-chosen-labels" ) {
+            settings.use_chosen_labels = false;
+        } else if( string(*argv) == "--exact-colors" ) {
+            settings.refinement.exact_colors = true;
+        } else if( string(*argv) == "--external" ) {
+            settings.external = true;
         } else if( string(*argv) == "--help" ) {
             usage(exec_name, cout);
             return 0;
+        } else if( string(*argv) == "--jobs" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            opt_jobs = max(1, atoi(*argv));
+        } else if( (string(*argv) == "--k-wl") || (string(*argv) == "--max-memory") || (string(*argv) == "--seed") ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            string option(*argv);
+            --argc;
+            ++argv;
+            if( option == "--max-memory" ) {
+                settings.kwl.max_memory = size_t(max(1, atoi(*argv))) << 20;
+            } else if( option == "--seed" ) {
+                settings.kwl.seed = strtoull(*argv, nullptr, 10);
+            } else {
+                settings.k = atoi(*argv);
+                if( (settings.k != 2) && (settings.k != 3) ) {
+                    cout << "Error: --k-wl must be 2 or 3" << endl;
+                    return -1;
+                }
+            }
+        } else if( (string(*argv) == "--kernel") || (string(*argv) == "--kernel-gram") ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            string option(*argv);
+            --argc;
+            ++argv;
+            if( option == "--kernel" ) {
+                opt_kernel_rounds = max(0, atoi(*argv));
+            } else {
+                opt_kernel_gram = *argv;
+            }
+        } else if( string(*argv) == "--label-subsets" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            opt_label_subsets = *argv;
+        } else if( (string(*argv) == "--max-rounds") || (string(*argv) == "--time-budget") ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            string option(*argv);
+            --argc;
+            ++argv;
+            if( option == "--max-rounds" ) {
+                settings.refinement.max_rounds = max(1, atoi(*argv));
+            } else {
+                settings.refinement.time_budget = max(0.0, atof(*argv));
+            }
+        } else if( (string(*argv) == "--memory-budget") || (string(*argv) == "--temp-dir") ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            string option(*argv);
+            --argc;
+            ++argv;
+            if( option == "--memory-budget" ) {
+                settings.external_options.memory_budget = size_t(max(0.0, atof(*argv)) * (1 << 20));
+            } else {
+                settings.external_options.temp_dir = *argv;
+            }
         } else if( string(*argv) == "--normalize-colors" ) {
-            opt_normalize_colors = true;
+            settings.refinement.normalize_colors = true;
+        } else if( (string(*argv) == "--output") || (string(*argv) == "--output-format") ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            string option(*argv);
+            --argc;
+            ++argv;
+            if( option == "--output" ) {
+                opt_output = *argv;
+            } else if( !ColorRefinement::ColoringWriter::parse_format(*argv, settings.output_format) ) {
+                cout << "Error: unrecognized output format '" << *argv << "'" << endl;
+                return -1;
+            }
+        } else if( string(*argv) == "--partition-refinement" ) {
+            settings.partition_refinement = true;
+        } else if( string(*argv) == "--processes" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            settings.num_processes = max(1, atoi(*argv));
+            settings.refinement.exact_colors = true;
+        } else if( string(*argv) == "--reorder" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            if( !GraphLibrary::parse_node_ordering(*argv, settings.node_ordering) ) {
+                cout << "Error: unrecognized node ordering '" << *argv << "'" << endl;
+                return -1;
+            }
+        } else if( string(*argv) == "--server" ) {
+            opt_server = true;
+        } else if( string(*argv) == "--socket" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            opt_socket = *argv;
+        } else if( string(*argv) == "--sparse-labels" ) {
+            settings.refinement.sparse_labels = true;
+        } else if( string(*argv) == "--stats" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            settings.stats = *argv;
+            if( (settings.stats != "text") && (settings.stats != "json") ) {
+                cout << "Error: unrecognized stats format '" << *argv << "'" << endl;
+                return -1;
+            }
+        } else if( string(*argv) == "--threads" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            settings.refinement.num_threads = max(1, atoi(*argv));
+            settings.refinement.exact_colors = true;
         } else if( string(*argv) == "--uniform-initial-coloring" ) {
-            opt_uniform_initial_coloring = true;
+            settings.uniform_initial_coloring = true;
+        } else if( string(*argv) == "--updates" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            settings.updates = *argv;
         } else if( string(*argv) == "--" ) {
             parsing_options = false;
         } else {
@@ -206,84 +964,220 @@ int main(int argc, const char **argv) {
         }
     }
 
-    if( argc == 0 ) {
-        usage(exec_name, cout);
-        return 0;
+    // worker processes are forked, which is unsafe while other threads run
+    if( (settings.num_processes > 1) && (opt_jobs > 1) ) {
+        cout << "Error: --processes cannot be used with --jobs" << endl;
+        return -1;
     }
 
-    //cout << "Max label number is " << numeric_limits<ulong>::max() << endl;
-    string filename = argv[0];
-    cout << "Reading file '" << filename << "' ..." << endl;
+    // k-WL refines tuples with its own engine, always to the stable coloring
+    if( (settings.k > 1) && (settings.partition_refinement || (settings.refinement.max_rounds > 0) || (settings.refinement.time_budget > 0)) ) {
+        cout << "Error: --partition-refinement, --max-rounds and --time-budget cannot be used with --k-wl" << endl;
+        return -1;
+    }
 
-    GraphLibrary::GraphDatabase graph_db;
-    if( boost::algorithm::ends_with(filename, ".lp") ) {
-        // reading a graph description from clingo file (ext .lp)
-        ifstream ifs(filename, ifstream::in);
-        if( ifs.is_open() ) {
-            GraphLibrary::Graph g = read_lp_graph(ifs, opt_uniform_initial_coloring, opt_use_chosen_labels);
-            graph_db.emplace_back(move(g));
-            ifs.close();
+    // splitter-based refinement neither folds colors nor runs threads
+    if( settings.partition_refinement && (settings.refinement.normalize_colors || (settings.refinement.num_threads > 1)) ) {
+        cout << "Error: --normalize-colors and --threads cannot be used with --partition-refinement" << endl;
+        return -1;
+    }
+
+    // splitter-based refinement has no rounds
+    if( settings.partition_refinement && ((settings.refinement.max_rounds > 0) || (settings.refinement.time_budget > 0)) ) {
+        cout << "Error: --max-rounds and --time-budget cannot be used with --partition-refinement" << endl;
+        return -1;
+    }
+
+    // edits name nodes by input id, and are refined to the stable coloring
+    if( !settings.updates.empty() && ((settings.k > 1) || settings.external || settings.partition_refinement || (settings.num_processes > 1) ||
+                                      (settings.node_ordering != GraphLibrary::NodeOrdering::Input) ||
+                                      (settings.refinement.max_rounds > 0) || (settings.refinement.time_budget > 0)) ) {
+        cout << "Error: --updates cannot be used with --external, --k-wl, --max-rounds, --partition-refinement, --processes, --reorder or --time-budget" << endl;
+        return -1;
+    }
+
+    // the coloring of k-tuples and the file streamed by --external have the input ids
+    if( (settings.node_ordering != GraphLibrary::NodeOrdering::Input) && ((settings.k > 1) || settings.external) ) {
+        cout << "Error: --reorder cannot be used with --k-wl or --external" << endl;
+        return -1;
+    }
+
+    // comparison, canonical labeling, kernel and label subsets run their own
+    // engines on graphs in memory, one at a time
+    int num_modes = int(opt_canonical) + int(opt_compare) + int(opt_kernel_rounds >= 0) + int(!opt_label_subsets.empty());
+    if( num_modes > 1 ) {
+        cout << "Error: --canonical, --compare, --kernel and --label-subsets cannot be used together" << endl;
+        return -1;
+    }
+    if( (num_modes > 0) && ((settings.k > 1) || settings.partition_refinement || settings.external || (settings.num_processes > 1) ||
+                            (settings.node_ordering != GraphLibrary::NodeOrdering::Input) || (settings.refinement.max_rounds > 0) ||
+                            (settings.refinement.time_budget > 0) || !settings.updates.empty() || !settings.stats.empty() || (opt_jobs > 1)) ) {
+        cout << "Error: --external, --jobs, --k-wl, --max-rounds, --partition-refinement, --processes, --reorder, --stats, --time-budget and --updates cannot be used with --canonical, --compare, --kernel or --label-subsets" << endl;
+        return -1;
+    }
+
+    // server mode: graphs come with requests, and are colored by the engine
+    // of ColorRefinement with the options of the server or of the request
+    if( (opt_server || !opt_socket.empty()) &&
+        ((settings.k > 1) || settings.partition_refinement || settings.external || (settings.num_processes > 1) ||
+         (settings.node_ordering != GraphLibrary::NodeOrdering::Input) || !settings.updates.empty() || !settings.stats.empty() ||
+         (opt_jobs > 1) || !opt_output.empty() || (num_modes > 0)) ) {
+        cout << "Error: --canonical, --compare, --external, --jobs, --k-wl, --kernel, --label-subsets, --output, --partition-refinement, --processes, --reorder, --stats and --updates cannot be used with --server or --socket" << endl;
+        return -1;
+    }
+    if( opt_server || !opt_socket.empty() ) {
+        server_options.refinement = settings.refinement;
+        server_options.uniform_initial_coloring = settings.uniform_initial_coloring;
+        server_options.use_chosen_labels = settings.use_chosen_labels;
+        server_options.output_format = settings.output_format;
+        ColorRefinement::WLServer server(server_options);
+        if( opt_socket.empty() ) {
+            server.serve(0, 1);
         } else {
-            cout << "Error: opening file '" << filename << "'" << endl;
+            string error;
+            if( !server.serve_socket(opt_socket, error) ) {
+                cout << "Error: " << error << endl;
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    // files given as arguments or listed in database, with directories
+    // replaced by their .lp and .wlg files (in lexicographic order)
+    vector<string> arguments(argv, argv + argc);
+    if( !opt_database.empty() ) {
+        ifstream is(opt_database);
+        if( !is ) {
+            cout << "Error: opening file '" << opt_database << "'" << endl;
             return -1;
         }
-    } else {
-        cout << "Error: unrecognized file extension" << endl;
+        for( string line; getline(is, line); ) {
+            if( !line.empty() ) arguments.push_back(line);
+        }
+    }
+    vector<string> filenames;
+    for( const string &argument : arguments ) {
+        error_code ec;
+        if( filesystem::is_directory(argument, ec) ) {
+            vector<string> entries;
+            for( const filesystem::directory_entry &entry : filesystem::directory_iterator(argument, ec) ) {
+                string path = entry.path().string();
+                if( entry.is_regular_file(ec) && (boost::algorithm::ends_with(path, ".lp") || boost::algorithm::ends_with(path, ".wlg")) )
+                    entries.push_back(path);
+            }
+            if( ec ) {
+                cout << "Error: reading directory '" << argument << "'" << endl;
+                return -1;
+            }
+            sort(entries.begin(), entries.end());
+            filenames.insert(filenames.end(), entries.begin(), entries.end());
+        } else {
+            filenames.push_back(argument);
+        }
+    }
+
+    if( filenames.empty() ) {
+        usage(exec_name, cout);
+        return 0;
+    }
+
+    if( !settings.updates.empty() && (filenames.size() != 1) ) {
+        cout << "Error: --updates requires one file" << endl;
         return -1;
     }
 
-    for( size_t i = 0; i < graph_db.size(); ++i ) {
-        const GraphLibrary::Graph &g = graph_db[i];
-        ColorRefinement::ColorRefinement cr(g);
+    if( opt_compare )
+        return compare_graphs(filenames, settings.uniform_initial_coloring, settings.use_chosen_labels);
 
-        // Manages colors of stable coloring.
-        unordered_set<Label> node_colors;
-        // Maps color to nodes.
-        unordered_multimap<Label, Node> colors_to_nodes;
-        // Maps node to color.
-        unordered_map<Node, Label> node_to_color;
+    if( !opt_label_subsets.empty() )
+        return evaluate_label_subsets(filenames, opt_label_subsets, settings.uniform_initial_coloring, settings.refinement);
 
-        // Remap edge labels so that they fall in { 0, ..., num_edge_labels - 1 }.
-        Labels edge_labels = g.get_edge_labels();
-        map<Label, Label> map_edge_label;
-        for( size_t i = 0; i < edge_labels.size(); ++i ) {
-            Label label = edge_labels[i];
-            if( map_edge_label.find(label) == map_edge_label.end() )
-                map_edge_label.emplace(label, map_edge_label.size());
-            edge_labels[i] = map_edge_label[label];
+    // open output (binary colorings are not written to the terminal)
+    FILE *output = stdout;
+    if( !opt_output.empty() ) {
+        output = fopen(opt_output.c_str(), "wb");
+        if( output == nullptr ) {
+            cout << "Error: opening file '" << opt_output << "'" << endl;
+            return -1;
         }
-        assert(map_edge_label.size() == g.get_set_edge_labels().size());
+    } else if( settings.output_format == ColorRefinement::ColoringWriter::Format::Binary ) {
+        cout << "Error: binary output requires --output" << endl;
+        return -1;
+    }
+    ColorRefinement::ColoringWriter writer(output);
 
-        // Compute stable coloring.
-        auto start = chrono::high_resolution_clock::now();
-        int num_iterations = cr.compute_stable_coloring(node_colors,
-                                                        colors_to_nodes,
-                                                        node_to_color,
-                                                        g.get_node_labels(),
-                                                        map_edge_label.size(),
-                                                        edge_labels,
-                                                        opt_normalize_colors);
-        auto end = chrono::high_resolution_clock::now();
-        double elapsed = chrono::duration<double>(end - start).count();
-        cout << "WL: #iterations=" << num_iterations << ", #colors=" << node_colors.size() << ", elapsed-time=" << elapsed << endl;
+    if( opt_canonical ) {
+        int status = compute_canonical_labelings(filenames, settings.uniform_initial_coloring, settings.use_chosen_labels, writer);
+        if( output != stdout ) fclose(output);
+        return status;
+    }
 
-        // Print summary of coloring.
-        uint total = 0;
-        for( Label label : node_colors ) {
-            uint n = colors_to_nodes.count(label);
-            total += n;
-            cout << n << " node(s) with color " << label << " :";
-            for( auto it = colors_to_nodes.find(label); it != colors_to_nodes.end() && it->first == label; ++it )
-              cout << " " << it->second;
-            cout << endl;
-        }
-        cout << "total " << total << " node(s)" << endl;
+    if( opt_kernel_rounds >= 0 ) {
+        int status = compute_kernel(filenames, opt_kernel_rounds, settings.refinement.num_threads, settings.uniform_initial_coloring,
+                                    settings.use_chosen_labels, writer, opt_kernel_gram);
+        if( output != stdout ) fclose(output);
+        return status;
+    }
 
-        // Print node coloring.
-        for( auto const& item : node_to_color ) {
-            cout << "color(" << item.first << "," << item.second << ")" << endl;
+    //cout << "Max label number is " << numeric_limits<ulong>::max() << endl;
+    settings.kwl.num_threads = settings.refinement.num_threads;
+    int status = 0;
+    if( filenames.size() == 1 ) {
+        if( !process_file(filenames[0], settings, cout, writer) ) status = -1;
+    } else {
+        // Batch: files are processed by a pool of workers, and their messages
+        // and colorings are written in input order as soon as available.
+        struct Result {
+            string log;
+            string coloring;
+            bool ok;
+            bool done;
+        };
+        vector<Result> results(filenames.size(), Result{ "", "", false, false });
+        mutex results_mutex;
+        condition_variable result_done;
+        GraphLibrary::WorkStealingPool pool(opt_jobs);
+        auto start = chrono::high_resolution_clock::now();
+        thread scheduler([&]() {
+            pool.run(filenames.size(), [&](size_t i) {
+                ostringstream log;
+                string coloring;
+                ColorRefinement::ColoringWriter coloring_writer(&coloring);
+                bool ok = process_file(filenames[i], settings, log, coloring_writer);
+                lock_guard<mutex> lock(results_mutex);
+                results[i].log = log.str();
+                results[i].coloring.swap(coloring);
+                results[i].ok = ok;
+                results[i].done = true;
+                result_done.notify_all();
+            });
+        });
+
+        size_t num_errors = 0;
+        for( size_t i = 0; i < filenames.size(); ++i ) {
+            Result result;
+            {
+                unique_lock<mutex> lock(results_mutex);
+                result_done.wait(lock, [&]() { return results[i].done; });
+                result = std::move(results[i]);
+            }
+            cout << result.log << flush;
+            writer.put(result.coloring.data(), result.coloring.size());
+            if( !writer.flush() ) {
+                cout << "Error: writing coloring" << endl;
+                result.ok = false;
+            }
+            if( !result.ok ) ++num_errors;
         }
+        scheduler.join();
+        auto end = chrono::high_resolution_clock::now();
+        double elapsed = chrono::duration<double>(end - start).count();
+        cout << "batch: #files=" << filenames.size() << ", #errors=" << num_errors << ", #jobs=" << pool.get_num_threads()
+             << ", elapsed-time=" << elapsed << ", throughput=" << (elapsed > 0 ? filenames.size() / elapsed : 0) << " files/s" << endl;
+        if( num_errors > 0 ) status = -1;
     }
 
-    return 0;
+    if( output != stdout ) fclose(output);
+    return status;
 }
@@ -0,0 +1,188 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CSRGraph.h"
+#include "ColorRefinement.h"
+#include "ColoringWriter.h"
+#include "Generators.h"
+#include "Graph.h"
+#include "LPReader.h"
+
+using namespace std;
+
+void usage(const string &exec_name, ostream &os) {
+    os << "Usage: " << exec_name << " [--dir DIR] [--exact-colors] [--generators LIST] [--help] [--keep-files] [--max-edges M] [--min-edges M] [--output FILE] [--seed S] [--threads N]" << endl
+       << endl
+       << "Benchmark color refinement on synthetic graphs of 10^3, 10^4, ... edges. Each graph is" << endl
+       << "written as clingo file, then parsing, graph construction, each refinement round and output" << endl
+       << "are timed separately. Results are written as one JSON object per line." << endl
+       << endl
+       << "optional arguments:" << endl
+       << "  --help                        show this help message and exit" << endl
+       << "  --dir DIR                     directory for generated files (default .)" << endl
+       << "  --exact-colors                intern node signatures into dense colors (no overflows)" << endl
+       << "  --generators LIST             comma-separated generators (default all):";
+    for( const string &name : GraphLibrary::get_generator_names() )
+        os << " " << name;
+    os << endl
+       << "  --keep-files                  don't remove generated files" << endl
+       << "  --max-edges M                 largest number of edges (default 1e7)" << endl
+       << "  --min-edges M                 smallest number of edges (default 1e3)" << endl
+       << "  --output FILE                 write results to FILE instead of standard output" << endl
+       << "  --seed S                      seed of random generators (default 0)" << endl
+       << "  --threads N                   compute exact colors using N threads (implies --exact-colors)" << endl;
+}
+
+inline double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Generate graph, write it and time the stages of wl on it. Writes a JSON
+// object to "os". Returns false on error.
+bool benchmark(const string &generator, size_t num_edges, uint64_t seed, const string &dir, bool keep_files,
+               const ColorRefinement::Options &options, ostream &os, string &error) {
+    string filename = dir + "/" + generator + "-" + to_string(num_edges) + ".lp";
+    GraphLibrary::LPGraph generated;
+    auto start = chrono::steady_clock::now();
+    if( !GraphLibrary::generate_graph(generator, num_edges, seed, generated, error) ||
+        !GraphLibrary::write_lp_file(filename, generated, error) )
+        return false;
+    double generate_time = seconds_since(start);
+    generated = GraphLibrary::LPGraph();
+
+    // Parse.
+    GraphLibrary::LPGraph lp_graph;
+    start = chrono::steady_clock::now();
+    bool ok = GraphLibrary::read_lp_file(filename, lp_graph, error);
+    double parse_time = seconds_since(start);
+    if( !keep_files ) remove(filename.c_str());
+    if( !ok ) return false;
+
+    // Build CSR view with remapped labels, as wl does.
+    start = chrono::steady_clock::now();
+    GraphLibrary::CSRGraph csr = GraphLibrary::make_remapped_csr_graph(GraphLibrary::make_graph(lp_graph, false, true));
+    double build_time = seconds_since(start);
+
+    // Refine.
+    vector<ColorRefinement::RoundStats> round_stats;
+    ColorRefinement::Options refinement = options;
+    refinement.round_stats = &round_stats;
+    ColorRefinement::Coloring coloring;
+    ColorRefinement::ColorRefinement cr(csr);
+    start = chrono::steady_clock::now();
+    int num_iterations = cr.compute_stable_coloring(coloring, csr.get_node_labels(), refinement);
+    double refine_time = seconds_since(start);
+
+    // Output (text format, into memory).
+    string text;
+    start = chrono::steady_clock::now();
+    {
+        ColorRefinement::ColoringWriter writer(&text);
+        writer.write(coloring, ColorRefinement::ColoringWriter::Format::Text);
+        writer.flush();
+    }
+    double output_time = seconds_since(start);
+
+    os << "{\"generator\":\"" << generator << "\""
+       << ",\"seed\":" << seed
+       << ",\"edges\":" << num_edges
+       << ",\"nodes\":" << lp_graph.num_nodes
+       << ",\"arcs\":" << lp_graph.edges_src.size()
+       << ",\"bytes\":" << lp_graph.num_bytes
+       << ",\"generate\":" << generate_time
+       << ",\"parse\":" << parse_time
+       << ",\"build\":" << build_time
+       << ",\"refine\":" << refine_time
+       << ",\"iterations\":" << num_iterations
+       << ",\"rounds\":[";
+    for( size_t i = 0; i < round_stats.size(); ++i )
+        os << (i > 0 ? "," : "") << round_stats[i].elapsed_time;
+    os << "],\"colors\":" << coloring.get_num_colors()
+       << ",\"output\":" << output_time
+       << ",\"output_bytes\":" << text.size()
+       << "}" << endl;
+    return true;
+}
+
+int main(int argc, const char **argv) {
+    string exec_name(*argv++);
+    --argc;
+
+    // parse options
+    ColorRefinement::Options options;
+    vector<string> opt_generators = GraphLibrary::get_generator_names();
+    string opt_dir = ".";
+    string opt_output;
+    bool opt_keep_files = false;
+    size_t opt_min_edges = 1000;
+    size_t opt_max_edges = 10000000;
+    uint64_t opt_seed = 0;
+    for( ; argc > 0; --argc, ++argv ) {
+        string option(*argv);
+        if( option == "--help" ) {
+            usage(exec_name, cout);
+            return 0;
+        } else if( option == "--exact-colors" ) {
+            options.exact_colors = true;
+        } else if( option == "--keep-files" ) {
+            opt_keep_files = true;
+        } else if( (option == "--dir") || (option == "--generators") || (option == "--max-edges") || (option == "--min-edges") ||
+                   (option == "--output") || (option == "--seed") || (option == "--threads") ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            if( option == "--dir" ) {
+                opt_dir = *argv;
+            } else if( option == "--generators" ) {
+                opt_generators.clear();
+                stringstream list(*argv);
+                for( string name; getline(list, name, ','); )
+                    opt_generators.push_back(name);
+            } else if( option == "--max-edges" ) {
+                opt_max_edges = size_t(stod(*argv));
+            } else if( option == "--min-edges" ) {
+                opt_min_edges = max<size_t>(1, size_t(stod(*argv)));
+            } else if( option == "--output" ) {
+                opt_output = *argv;
+            } else if( option == "--seed" ) {
+                opt_seed = stoull(*argv);
+            } else {
+                options.num_threads = max(1, atoi(*argv));
+                options.exact_colors = true;
+            }
+        } else {
+            cout << "Error: unrecognized option '" << *argv << "'" << endl;
+            return -1;
+        }
+    }
+
+    ofstream file;
+    if( !opt_output.empty() ) {
+        file.open(opt_output);
+        if( !file ) {
+            cout << "Error: opening file '" << opt_output << "'" << endl;
+            return -1;
+        }
+    }
+    ostream &os = opt_output.empty() ? cout : file;
+
+    for( size_t num_edges = opt_min_edges; num_edges <= opt_max_edges; num_edges *= 10 ) {
+        for( const string &generator : opt_generators ) {
+            string error;
+            if( !benchmark(generator, num_edges, opt_seed, opt_dir, opt_keep_files, options, os, error) ) {
+                cout << "Error: " << error << endl;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "Generators.h"
+#include "LPReader.h"
+
+using namespace std;
+
+void usage(const string &exec_name, ostream &os) {
+    os << "Usage: " << exec_name << " [--help] [--seed S] generator edges output" << endl
+       << endl
+       << "Write synthetic graph with about the given number of edges as clingo file (ext .lp)." << endl
+       << endl
+       << "positional arguments:" << endl
+       << "  generator                     one of:";
+    for( const string &name : GraphLibrary::get_generator_names() )
+        os << " " << name;
+    os << endl
+       << "  edges                         number of edges (edge/1 atoms)" << endl
+       << "  output                        clingo file to write" << endl
+       << endl
+       << "optional arguments:" << endl
+       << "  --help                        show this help message and exit" << endl
+       << "  --seed S                      seed of random generator (default 0)" << endl;
+}
+
+int main(int argc, const char **argv) {
+    string exec_name(*argv++);
+    --argc;
+
+    uint64_t opt_seed = 0;
+    for( ; (argc > 0) && (**argv == '-'); --argc, ++argv ) {
+        if( string(*argv) == "--help" ) {
+            usage(exec_name, cout);
+            return 0;
+        } else if( string(*argv) == "--seed" ) {
+            if( argc == 1 ) {
+                cout << "Error: missing argument for '" << *argv << "'" << endl;
+                return -1;
+            }
+            --argc;
+            ++argv;
+            opt_seed = stoull(*argv);
+        } else {
+            cout << "Error: unrecognized option '" << *argv << "'" << endl;
+            return -1;
+        }
+    }
+    if( argc != 3 ) {
+        usage(exec_name, cout);
+        return -1;
+    }
+
+    string generator = argv[0], output = argv[2];
+    size_t num_edges = size_t(stod(argv[1]));
+    GraphLibrary::LPGraph lp_graph;
+    string error;
+    auto start = chrono::high_resolution_clock::now();
+    if( !GraphLibrary::generate_graph(generator, num_edges, opt_seed, lp_graph, error) ||
+        !GraphLibrary::write_lp_file(output, lp_graph, error) ) {
+        cout << "Error: " << error << endl;
+        return -1;
+    }
+    auto end = chrono::high_resolution_clock::now();
+    double elapsed = chrono::duration<double>(end - start).count();
+    cout << "graph: #nodes=" << lp_graph.num_nodes << ", #edges=" << lp_graph.edges_src.size() << ", #edge-labels=" << lp_graph.label_names.size() << endl;
+    cout << "generate: " << generator << " -> '" << output << "', seed=" << opt_seed << ", elapsed-time=" << elapsed << endl;
+    return 0;
+}